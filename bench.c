@@ -0,0 +1,208 @@
+/*
+ * bench.c - robust statistics over repeated benchmark runs, see bench.h
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+
+#define BENCH_SEED 0x9e3779b97f4a7c15ULL
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Median of x, which is sorted in place */
+static double median_sorted(double *x, int n)
+{
+    qsort(x, n, sizeof(double), cmp_double);
+    return (n % 2) ? x[n/2] : (x[n/2 - 1] + x[n/2]) / 2;
+}
+
+static double *copy(const double *x, int n)
+{
+    double *c;
+
+    if ((c = malloc((n > 0 ? n : 1) * sizeof(double))) == NULL) {
+	fprintf(stderr, "bench: out of memory\n");
+	exit(1);
+    }
+    memcpy(c, x, n * sizeof(double));
+    return c;
+}
+
+/* xorshift64*: a fast generator, plenty for resampling */
+static unsigned long long next_rand(unsigned long long *s)
+{
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 2685821657736338717ULL;
+}
+
+/* Fill r with n values drawn from x[0..n-1] with replacement */
+static void resample(const double *x, int n, double *r, unsigned long long *s)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	r[i] = x[next_rand(s) % n];
+}
+
+/* The (1-conf)/2 and (1+conf)/2 quantiles of the stats[0..n-1] */
+static void quantiles(double *stats, int n, double conf, double *lo, double *hi)
+{
+    int l, h;
+
+    qsort(stats, n, sizeof(double), cmp_double);
+    l = (int)((1 - conf) / 2 * n);
+    h = (int)((1 + conf) / 2 * n);
+    *lo = stats[l];
+    *hi = stats[h < n ? h : n - 1];
+}
+
+double bench_median(const double *x, int n)
+{
+    double *c, m;
+
+    if (n == 0)
+	return 0;
+    c = copy(x, n);
+    m = median_sorted(c, n);
+    free(c);
+    return m;
+}
+
+double bench_mad(const double *x, int n)
+{
+    double *c, m;
+    int i;
+
+    if (n == 0)
+	return 0;
+    m = bench_median(x, n);
+    c = copy(x, n);
+    for (i = 0; i < n; i++)
+	c[i] = fabs(c[i] - m);
+    m = median_sorted(c, n);
+    free(c);
+    return m;
+}
+
+void bench_ci(const double *x, int n, double conf, double *lo, double *hi)
+{
+    double *r, *stats;
+    unsigned long long s = BENCH_SEED;
+    int i;
+
+    if (n == 0) {
+	*lo = *hi = 0;
+	return;
+    }
+    r = copy(x, n);
+    stats = malloc(BENCH_RESAMPLES * sizeof(double));
+    if (stats == NULL) {
+	fprintf(stderr, "bench: out of memory\n");
+	exit(1);
+    }
+    for (i = 0; i < BENCH_RESAMPLES; i++) {
+	resample(x, n, r, &s);
+	stats[i] = median_sorted(r, n);
+    }
+    quantiles(stats, BENCH_RESAMPLES, conf, lo, hi);
+    free(stats);
+    free(r);
+}
+
+void bench_diff_ci(const double *x, int nx, const double *y, int ny,
+		   double conf, double *lo, double *hi)
+{
+    double *rx, *ry, *stats, mx;
+    unsigned long long s = BENCH_SEED;
+    int i;
+
+    if (nx == 0 || ny == 0) {
+	*lo = *hi = 0;
+	return;
+    }
+    rx = copy(x, nx);
+    ry = copy(y, ny);
+    stats = malloc(BENCH_RESAMPLES * sizeof(double));
+    if (stats == NULL) {
+	fprintf(stderr, "bench: out of memory\n");
+	exit(1);
+    }
+    for (i = 0; i < BENCH_RESAMPLES; i++) {
+	resample(x, nx, rx, &s);
+	resample(y, ny, ry, &s);
+	mx = median_sorted(rx, nx);
+	stats[i] = (mx != 0) ? median_sorted(ry, ny) / mx - 1 : 0;
+    }
+    quantiles(stats, BENCH_RESAMPLES, conf, lo, hi);
+    free(stats);
+    free(ry);
+    free(rx);
+}
+
+/* One sample of the pooled data: its value and which set it came from */
+typedef struct {
+    double v;
+    int from_y;
+} pooled_t;
+
+static int cmp_pooled(const void *a, const void *b)
+{
+    return cmp_double(&((const pooled_t *)a)->v, &((const pooled_t *)b)->v);
+}
+
+double bench_mannwhitney(const double *x, int nx, const double *y, int ny)
+{
+    pooled_t *p;
+    int n = nx + ny, i, j;
+    double rank, rx = 0, ties = 0, t, u, mu, sigma, z;
+
+    if (nx == 0 || ny == 0)
+	return 1;
+    if ((p = malloc(n * sizeof(pooled_t))) == NULL) {
+	fprintf(stderr, "bench: out of memory\n");
+	exit(1);
+    }
+    for (i = 0; i < nx; i++) {
+	p[i].v = x[i];
+	p[i].from_y = 0;
+    }
+    for (i = 0; i < ny; i++) {
+	p[nx + i].v = y[i];
+	p[nx + i].from_y = 1;
+    }
+    qsort(p, n, sizeof(pooled_t), cmp_pooled);
+
+    /* Sum the ranks of x, giving each run of ties their average rank */
+    for (i = 0; i < n; i = j) {
+	for (j = i + 1; j < n && p[j].v == p[i].v; j++)
+	    ;
+	rank = (i + 1 + j) / 2.0;
+	t = j - i;
+	ties += t * t * t - t;
+	while (i < j)
+	    if (!p[i++].from_y)
+		rx += rank;
+    }
+    free(p);
+
+    u = rx - nx * (nx + 1) / 2.0;
+    mu = nx * (double)ny / 2;
+    sigma = sqrt(nx * (double)ny / 12 * ((n + 1) - ties / (n * (double)(n - 1))));
+    if (sigma == 0)
+	return 1;
+    /* continuity correction toward the mean */
+    z = (fabs(u - mu) - 0.5) / sigma;
+    if (z < 0)
+	z = 0;
+    return erfc(z / sqrt(2));
+}
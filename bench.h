@@ -0,0 +1,34 @@
+#ifndef __BENCH_H_
+#define __BENCH_H_
+
+/*
+ * bench.h - robust statistics over repeated benchmark runs
+ *
+ * Timings are skewed by the occasional interrupt or migration, so the
+ * summaries are the median and the median absolute deviation (MAD)
+ * rather than the mean and standard deviation. Confidence intervals are
+ * percentile bootstraps of the median, which assume nothing about the
+ * shape of the distribution. The resampling uses a fixed seed, so the
+ * same samples always give the same interval.
+ */
+#define BENCH_RESAMPLES 2000 /* bootstrap resamples per interval */
+
+/* Median of x[0..n-1] (x is not modified) */
+double bench_median(const double *x, int n);
+
+/* Median absolute deviation from the median of x[0..n-1] */
+double bench_mad(const double *x, int n);
+
+/* conf (e.g. 0.95) bootstrap confidence interval of the median of x */
+void bench_ci(const double *x, int n, double conf, double *lo, double *hi);
+
+/* conf bootstrap confidence interval of median(y)/median(x) - 1, the
+   relative change from x to y */
+void bench_diff_ci(const double *x, int nx, const double *y, int ny,
+		   double conf, double *lo, double *hi);
+
+/* Two-sided p-value of the Mann-Whitney U test that x and y come from
+   the same distribution (normal approximation, corrected for ties) */
+double bench_mannwhitney(const double *x, int nx, const double *y, int ny);
+
+#endif /* __BENCH_H_ */
@@ -1,6 +1,6 @@
 /* 
- * clock.c - Routines for using the cycle counters on x86, 
- *           Alpha, and Sparc boxes.
+ * clock.c - Routines for using the cycle counters on x86, x86-64
+ *           and Alpha boxes, and a nanosecond clock everywhere else.
  * 
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
@@ -9,67 +9,96 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/times.h>
 #include "clock.h"
 
+/* The clock that calibrates the cycle counter, and that stands in for it
+   on machines without one: counts nanoseconds, never set or slewed */
+#if defined(CLOCK_MONOTONIC_RAW)
+#define NS_CLOCK CLOCK_MONOTONIC_RAW
+#elif defined(CLOCK_MONOTONIC)
+#define NS_CLOCK CLOCK_MONOTONIC
+#endif
+
+#ifdef NS_CLOCK
+/* Return the nanosecond clock */
+static unsigned long long ns_now()
+{
+    struct timespec ts;
+
+    clock_gettime(NS_CLOCK, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
 
 /******************************************************* 
  * Machine dependent functions 
  *
- * Note: the constants __i386__ and  __alpha
+ * Note: the constants __i386__, __x86_64__ and __alpha
  * are set by GCC when it calls the C preprocessor
  * You can verify this for yourself using gcc -v.
  *******************************************************/
 
-#if defined(__i386__)  
+#if defined(__i386__) || defined(__x86_64__)
 /*******************************************************
- * Pentium versions of start_counter() and get_counter()
+ * x86 (32- and 64-bit) versions of start_counter() and get_counter()
  *******************************************************/
+#include <cpuid.h>
 
+#define TSC_RDTSCP    0x1 /* rdtscp is available */
+#define TSC_INVARIANT 0x2 /* the TSC ticks at a constant rate in all states */
+#define TSC_CHECKED   0x4 /* the flags above are set */
 
-/* $begin x86cyclecounter */
-/* Initialize the cycle counter */
-static unsigned cyc_hi = 0;
-static unsigned cyc_lo = 0;
+static unsigned long long cyc_start = 0;
+static int tsc_flags = 0;
 
+/* Look up which TSC features the processor has. Without an invariant
+   TSC, counts taken across frequency changes or sleep are unreliable. */
+static void tsc_check()
+{
+    unsigned eax, ebx, ecx, edx;
+
+    tsc_flags = TSC_CHECKED;
+    if (__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) && (edx & (1 << 27)))
+	tsc_flags |= TSC_RDTSCP;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1 << 8)))
+	tsc_flags |= TSC_INVARIANT;
+    else
+	fprintf(stderr, "Warning: the TSC is not invariant; cycle counts "
+		"may vary with the clock rate\n");
+}
 
-/* Set *hi and *lo to the high and low order bits  of the cycle counter.  
-   Implementation requires assembly code to use the rdtsc instruction. */
-void access_counter(unsigned *hi, unsigned *lo)
+/* Return the time stamp counter once every earlier instruction has
+   finished and before any later one starts. rdtscp waits for the ones
+   before it; the lfence holds back the ones after. */
+unsigned long long read_counter()
 {
-    asm("rdtsc; movl %%edx,%0; movl %%eax,%1"   /* Read cycle counter */
-	: "=r" (*hi), "=r" (*lo)                /* and move results to */
-	: /* No input */                        /* the two outputs */
-	: "%edx", "%eax");
+    unsigned hi, lo, aux;
+
+    if (!(tsc_flags & TSC_CHECKED))
+	tsc_check();
+    if (tsc_flags & TSC_RDTSCP)
+	asm volatile("rdtscp; lfence"
+		     : "=a" (lo), "=d" (hi), "=c" (aux) : : "memory");
+    else
+	asm volatile("lfence; rdtsc; lfence"
+		     : "=a" (lo), "=d" (hi) : : "memory");
+    return ((unsigned long long)hi << 32) | lo;
 }
 
 /* Record the current value of the cycle counter. */
 void start_counter()
 {
-    access_counter(&cyc_hi, &cyc_lo);
+    cyc_start = read_counter();
 }
 
 /* Return the number of cycles since the last call to start_counter. */
 double get_counter()
 {
-    unsigned ncyc_hi, ncyc_lo;
-    unsigned hi, lo, borrow;
-    double result;
-
-    /* Get cycle counter */
-    access_counter(&ncyc_hi, &ncyc_lo);
-
-    /* Do double precision subtraction */
-    lo = ncyc_lo - cyc_lo;
-    borrow = lo > ncyc_lo;
-    hi = ncyc_hi - cyc_hi - borrow;
-    result = (double) hi * (1 << 30) * 4 + lo;
-    if (result < 0) {
-	fprintf(stderr, "Error: counter returns neg value: %.0f\n", result);
-    }
-    return result;
+    return (double)(read_counter() - cyc_start);
 }
-/* $end x86cyclecounter */
 
 #elif defined(__alpha)
 
@@ -133,6 +162,36 @@ double get_counter()
     return result;
 }
 
+/* Return the raw (32-bit) cycle counter, for timing individual calls */
+unsigned long long read_counter()
+{
+    return counter();
+}
+
+#elif defined(NS_CLOCK)
+
+/****************************************************************
+ * All the other platforms: count nanoseconds instead of cycles, so
+ * the "clock rate" that mhz() finds is 1000 MHz
+ ***************************************************************/
+
+static unsigned long long ns_start = 0;
+
+void start_counter()
+{
+    ns_start = ns_now();
+}
+
+double get_counter()
+{
+    return (double)(ns_now() - ns_start);
+}
+
+unsigned long long read_counter()
+{
+    return ns_now();
+}
+
 #else
 
 /****************************************************************
@@ -158,6 +217,13 @@ double get_counter()
     printf("Please choose another timing package in config.h.\n");
     exit(1);
 }
+
+unsigned long long read_counter()
+{
+    printf("ERROR: You are trying to use a read_counter routine in clock.c\n");
+    printf("that has not been implemented yet on this platform.\n");
+    exit(1);
+}
 #endif
 
 
@@ -185,10 +251,20 @@ double ovhd()
 double mhz_full(int verbose, int sleeptime)
 {
     double rate;
+#ifdef NS_CLOCK
+    unsigned long long start, end;
 
+    /* Time the sleep itself, which may run over */
+    start_counter();
+    start = ns_now();
+    sleep(sleeptime);
+    end = ns_now();
+    rate = get_counter() / ((end - start) / 1e3);
+#else
     start_counter();
     sleep(sleeptime);
     rate = get_counter() / (1e6*sleeptime);
+#endif
     if (verbose) 
 	printf("Processor clock rate ~= %.1f MHz\n", rate);
     return rate;
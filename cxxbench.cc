@@ -0,0 +1,207 @@
+/*
+ * cxxbench.cc - C++ container churn on mm.c vs. the default allocator
+ *
+ * Runs the same std::map, std::unordered_map and std::vector workloads
+ * with std::allocator (libc malloc) and with mm::allocator, and through
+ * std::pmr containers with mm::memory_resource, and prints the time
+ * for each. The mm heap is reset before every run, as in eval_mm_speed.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <memory_resource>
+
+#include "mm_cxx.h"
+
+extern "C" {
+#include "fsecs.h"
+}
+
+int verbose = 0; /* read by fsecs.c */
+
+static int nkeys = 20000;  /* keys per map workload (-n) */
+static int rounds = 4;     /* churn rounds per workload (-r) */
+
+/* Deterministic key sequence so every allocator sees the same requests */
+static unsigned int next_key(unsigned int *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 8) % (unsigned int)(nkeys * 4);
+}
+
+/*
+ * map_churn - insert nkeys random keys, erase about half, refill
+ */
+template <class Map>
+static void map_churn(Map &m)
+{
+    unsigned int seed = 1;
+    int r, i;
+
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < nkeys; i++)
+            m[next_key(&seed)] = i;
+        for (i = 0; i < nkeys / 2; i++)
+            m.erase(next_key(&seed));
+    }
+    m.clear();
+}
+
+/*
+ * vector_churn - grow many small vectors by push_back, drop every other one
+ */
+template <class Outer>
+static void vector_churn(Outer &vs)
+{
+    unsigned int seed = 7;
+    int r, i, j, n;
+
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < nkeys / 20; i++) {
+            vs.emplace_back();
+            n = next_key(&seed) % 256;
+            for (j = 0; j < n; j++)
+                vs.back().push_back(j);
+        }
+        for (i = 0; i < (int)vs.size(); i += 2) {
+            vs[i].clear();
+            vs[i].shrink_to_fit();
+        }
+    }
+    vs.clear();
+}
+
+/* The timed functions, one per (workload, allocator) pair */
+typedef std::less<unsigned int> key_less;
+typedef std::hash<unsigned int> key_hash;
+typedef std::equal_to<unsigned int> key_eq;
+typedef std::pair<const unsigned int, int> kv_t;
+
+static void map_std(void *arg)
+{
+    std::map<unsigned int, int> m;
+    map_churn(m);
+}
+
+static void map_mm(void *arg)
+{
+    mm::reset();
+    std::map<unsigned int, int, key_less, mm::allocator<kv_t> > m;
+    map_churn(m);
+}
+
+static void map_pmr(void *arg)
+{
+    mm::reset();
+    std::pmr::map<unsigned int, int> m((mm::memory_resource *)arg);
+    map_churn(m);
+}
+
+static void umap_std(void *arg)
+{
+    std::unordered_map<unsigned int, int> m;
+    map_churn(m);
+}
+
+static void umap_mm(void *arg)
+{
+    mm::reset();
+    std::unordered_map<unsigned int, int, key_hash, key_eq,
+                       mm::allocator<kv_t> > m;
+    map_churn(m);
+}
+
+static void umap_pmr(void *arg)
+{
+    mm::reset();
+    std::pmr::unordered_map<unsigned int, int> m((mm::memory_resource *)arg);
+    map_churn(m);
+}
+
+static void vec_std(void *arg)
+{
+    std::vector<std::vector<int> > vs;
+    vector_churn(vs);
+}
+
+static void vec_mm(void *arg)
+{
+    typedef std::vector<int, mm::allocator<int> > vec;
+    mm::reset();
+    std::vector<vec, mm::allocator<vec> > vs;
+    vector_churn(vs);
+}
+
+static void vec_pmr(void *arg)
+{
+    mm::reset();
+    std::pmr::vector<std::pmr::vector<int> > vs((mm::memory_resource *)arg);
+    vector_churn(vs);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: cxxbench [-h] [-n <keys>] [-r <rounds>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h          Print this message.\n");
+    fprintf(stderr, "\t-n <keys>   Keys per map workload (default 20000).\n");
+    fprintf(stderr, "\t-r <rounds> Churn rounds per workload (default 4).\n");
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        fsecs_test_funct std_f, mm_f, pmr_f;
+    } tests[] = {
+        {"map",           map_std,  map_mm,  map_pmr},
+        {"unordered_map", umap_std, umap_mm, umap_pmr},
+        {"vector",        vec_std,  vec_mm,  vec_pmr},
+    };
+    mm::memory_resource res;
+    double std_secs, mm_secs, pmr_secs;
+    unsigned int i;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:r:h")) != EOF) {
+        switch (c) {
+        case 'n':
+            nkeys = atoi(optarg);
+            break;
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+
+    if (!mm::init()) {
+        printf("mm_init failed\n");
+        exit(1);
+    }
+    init_fsecs();
+
+    printf("%-14s%12s%12s%12s%8s\n", "workload", "std secs", "mm secs",
+           "pmr secs", "mm/std");
+    for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        std_secs = fsecs(tests[i].std_f, NULL);
+        mm_secs = fsecs(tests[i].mm_f, NULL);
+        pmr_secs = fsecs(tests[i].pmr_f, &res);
+        printf("%-14s%12.6f%12.6f%12.6f%8.2f\n", tests[i].name,
+               std_secs, mm_secs, pmr_secs, mm_secs / std_secs);
+    }
+    exit(0);
+}
@@ -2,6 +2,7 @@
  * High-level timing wrappers
  ****************************/
 #include <stdio.h>
+#include <sys/time.h>
 #include "fsecs.h"
 #include "fcyc.h"
 #include "clock.h"
@@ -54,4 +55,30 @@ double fsecs(fsecs_test_funct f, void *argp)
 #endif 
 }
 
+/*
+ * fsecs_samples - Run f(argp) warmup times untimed, then n more times,
+ *     storing the running time of each of those (in seconds) in secs
+ */
+void fsecs_samples(fsecs_test_funct f, void *argp, int warmup, int n,
+		   double *secs)
+{
+    int i;
+#if !USE_FCYC
+    struct timeval start, end;
+#endif
 
+    for (i = 0; i < warmup; i++)
+	f(argp);
+    for (i = 0; i < n; i++) {
+#if USE_FCYC
+	start_counter();
+	f(argp);
+	secs[i] = get_counter() / (Mhz*1e6);
+#else
+	gettimeofday(&start, NULL);
+	f(argp);
+	gettimeofday(&end, NULL);
+	secs[i] = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+#endif
+    }
+}
@@ -2,3 +2,5 @@ typedef void (*fsecs_test_funct)(void *);
 
 void init_fsecs(void);
 double fsecs(fsecs_test_funct f, void *argp);
+void fsecs_samples(fsecs_test_funct f, void *argp, int warmup, int n,
+		   double *secs);
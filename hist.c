@@ -0,0 +1,78 @@
+/*
+ * hist.c - log-linear latency histograms, see hist.h
+ */
+#include <string.h>
+
+#include "hist.h"
+
+/*
+ * hist_index - bucket of v. Values below HIST_SUB get a bucket each;
+ *     above that, the top HIST_SUB_BITS+1 bits of v pick the bucket.
+ */
+static int hist_index(unsigned long long v)
+{
+    int msb, shift;
+
+    if (v < HIST_SUB)
+	return (int)v;
+    msb = 63 - __builtin_clzll(v);
+    shift = msb - HIST_SUB_BITS;
+    return ((shift + 1) << HIST_SUB_BITS) + (int)((v >> shift) - HIST_SUB);
+}
+
+/*
+ * hist_highest - largest value that falls in bucket b
+ */
+static unsigned long long hist_highest(int b)
+{
+    int shift;
+
+    if (b < HIST_SUB)
+	return b;
+    shift = (b >> HIST_SUB_BITS) - 1;
+    return ((((unsigned long long)(b & (HIST_SUB - 1)) + HIST_SUB + 1)
+	     << shift) - 1);
+}
+
+void hist_reset(hist_t *h)
+{
+    memset(h, 0, sizeof(hist_t));
+}
+
+void hist_record(hist_t *h, unsigned long long v)
+{
+    h->buckets[hist_index(v)]++;
+    h->count++;
+    if (v > h->max)
+	h->max = v;
+}
+
+void hist_merge(hist_t *dst, const hist_t *src)
+{
+    int b;
+
+    for (b = 0; b < HIST_BUCKETS; b++)
+	dst->buckets[b] += src->buckets[b];
+    dst->count += src->count;
+    if (src->max > dst->max)
+	dst->max = src->max;
+}
+
+unsigned long long hist_percentile(const hist_t *h, double pct)
+{
+    unsigned long long want, seen = 0;
+    int b;
+
+    if (h->count == 0)
+	return 0;
+    want = (unsigned long long)(pct / 100.0 * h->count + 0.5);
+    if (want < 1)
+	want = 1;
+    for (b = 0; b < HIST_BUCKETS; b++) {
+	seen += h->buckets[b];
+	if (seen >= want)
+	    break;
+    }
+    /* The top bucket's upper edge can overshoot the true maximum */
+    return (hist_highest(b) < h->max) ? hist_highest(b) : h->max;
+}
@@ -0,0 +1,35 @@
+#ifndef __HIST_H_
+#define __HIST_H_
+
+/*
+ * hist.h - log-linear latency histograms
+ *
+ * Values (cycle counts) are binned as in HdrHistogram: each power of two
+ * is split into HIST_SUB linear sub-buckets, so any recorded value is
+ * known to within 1/HIST_SUB of itself while the whole 64-bit range fits
+ * in a fixed array. Recording is a few shifts and an increment.
+ */
+#define HIST_SUB_BITS 5                  /* 32 sub-buckets: ~3% precision */
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS  ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct {
+    unsigned long long count;             /* values recorded */
+    unsigned long long max;               /* largest value recorded, exact */
+    unsigned long long buckets[HIST_BUCKETS];
+} hist_t;
+
+/* Empty the histogram */
+void hist_reset(hist_t *h);
+
+/* Record one value */
+void hist_record(hist_t *h, unsigned long long v);
+
+/* Add every value recorded in src to dst */
+void hist_merge(hist_t *dst, const hist_t *src);
+
+/* Smallest value v such that at least pct percent of values are <= v,
+   up to the bucket precision; 0 if the histogram is empty */
+unsigned long long hist_percentile(const hist_t *h, double pct);
+
+#endif /* __HIST_H_ */
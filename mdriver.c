@@ -7,6 +7,7 @@
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
  */
+#define _GNU_SOURCE /* for sched_setaffinity */
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -15,11 +16,20 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <math.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include "mm.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "clock.h"
+#include "hist.h"
+#include "perfctr.h"
+#include "bench.h"
 #include "config.h"
+#include "trace.h"
 
 /**********************
  * Constants and macros
@@ -30,6 +40,48 @@
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
 
+/* Pointer-chasing benchmark (-c) */
+#define CHASE_INTERVAL 64 /* trace ops between walks of the live blocks */
+
+/* Lifetime oracle (-o): blocks freed within this many ops are short-lived */
+#define SHORT_LIFETIME 1000
+
+/* Handle replay (-k): call mm_compact with this budget every so many ops */
+#define COMPACT_INTERVAL 100 /* trace ops between calls to mm_compact */
+#define COMPACT_BUDGET   50  /* usecs per call to mm_compact */
+
+/* Streaming replay (-S): initial slots in the live-id map, a power of 2 */
+#define IDMAP_INIT 1024
+#define IDMAP_EMPTY 0xffffffffu /* id of an unused slot */
+#define STREAM_TIMED 3 /* timed passes after the untimed one; the best counts */
+
+/* Threaded replay (-T) */
+#define MAX_THREADS 64
+
+/* Replay touching the payloads (-A): every TOUCH_INTERVAL ops, read up
+   to TOUCH_LINES cache lines of each of the last TOUCH_HOT blocks
+   allocated that are still live */
+#define TOUCH_INTERVAL 16
+#define TOUCH_HOT      64
+#define TOUCH_LINES    4
+#define CACHE_LINE     64
+
+/* Parameter sweep (-s): a grid sweep tries every combination of
+   SWEEP_GRID values of each tunable; each configuration is timed by the
+   median of SWEEP_RUNS runs of each trace */
+#define SWEEP_GRID 3
+#define SWEEP_RUNS 5
+#define SWEEP_FILE "sweep.csv" /* default output of the Pareto front */
+
+/* Placement instrumentation (-I): histogram bars are at most HIST_BAR
+   characters of INSTR_BAR */
+#define HIST_BAR  40
+#define INSTR_BAR "########################################"
+
+/* Benchmark mode (-B) */
+#define BENCH_WARMUP 3    /* untimed runs of each trace before the samples */
+#define BENCH_CONF   0.95 /* confidence level of the reported intervals */
+
 /* Returns true if p is ALIGNMENT-byte aligned */
 #define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
 
@@ -37,30 +89,18 @@
  * The key compound data types
  *****************************/
 
-/* Records the extent of each block's payload */
+/* Records the extent of each block's payload, as a node of a treap
+   (a binary search tree on lo, heap-ordered on a random priority) */
 typedef struct range_t {
     char *lo;              /* low payload address */
     char *hi;              /* high payload address */
-    struct range_t *next;  /* next list element */
+    unsigned prio;         /* random priority, larger is nearer the root */
+    struct range_t *left;  /* ranges with smaller lo */
+    struct range_t *right; /* ranges with larger lo */
 } range_t;
 
-/* Characterizes a single trace operation (allocator request) */
-typedef struct {
-    enum {ALLOC, FREE, REALLOC} type; /* type of request */
-    int index;                        /* index for free() to use later */
-    int size;                         /* byte size of alloc/realloc request */
-} traceop_t;
-
-/* Holds the information for one trace file*/
-typedef struct {
-    int sugg_heapsize;   /* suggested heap size (unused) */
-    int num_ids;         /* number of alloc/realloc ids */
-    int num_ops;         /* number of distinct requests */
-    int weight;          /* weight for this trace (unused) */
-    traceop_t *ops;      /* array of requests */
-    char **blocks;       /* array of ptrs returned by malloc/realloc... */
-    size_t *block_sizes; /* ... and a corresponding array of payload sizes */
-} trace_t;
+/* range_t records are carved from malloc'd chunks of this many */
+#define RANGE_CHUNK 4096
 
 /*
  * Holds the params to the xxx_speed functions, which are timed by fcyc.
@@ -78,6 +118,7 @@ typedef struct {
     double ops;      /* number of ops (malloc/free/realloc) in the trace */
     int valid;       /* was the trace processed correctly by the allocator? */
     double secs;     /* number of secs needed to run the trace */
+    int unchecked;   /* valid only in that it ran: payloads unchecked (-S) */
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
@@ -85,6 +126,105 @@ typedef struct {
     /* Note: secs and util are only defined if valid is true */
 } stats_t;
 
+/* Handle replay results for one trace, without and with mm_compact */
+typedef struct {
+    double util[2];  /* space utilization */
+    int moved;       /* blocks moved by mm_compact */
+} compact_t;
+
+/* Heap extension results for one trace (-E) */
+typedef struct {
+    int extends;     /* extend_heap calls */
+    size_t heap;     /* heap size when the live bytes peaked */
+    size_t tail;     /* free bytes at the end of the heap then */
+} extend_t;
+
+/* Per-op latency (-p): one histogram of cycles per request type,
+   indexed by ALLOC, FREE and REALLOC */
+typedef struct {
+    hist_t op[3];
+} latency_t;
+
+/* Hardware counters (-P) over one replay of a trace by eval_mm_speed,
+   indexed like perfctr_t.count; -1 where a counter is unavailable */
+typedef struct {
+    double count[PC_NUM];
+} counters_t;
+
+/* Benchmark mode (-B): the throughput of each timed run of one trace */
+typedef struct {
+    int runs;
+    double *kops;    /* Kops of each run */
+} bench_t;
+
+/* Parameter sweep (-s): one configuration of the mm.c tunables and how
+   it did on each trace */
+typedef struct {
+    int tune[MM_NUM_TUNABLES]; /* value of each tunable */
+    int valid;       /* did every trace replay correctly? */
+    double *util;    /* util on each trace */
+    double *secs;    /* median time of each trace */
+} sweep_t;
+
+/* Threaded replay results for one trace */
+typedef struct {
+    double secs;     /* wall time from the first request to the last */
+    double ops;      /* requests replayed by all the threads */
+    hist_t *lat;     /* per-thread cycles per request, lock wait included */
+} mt_t;
+
+/* What the threads of one threaded replay share */
+typedef struct {
+    trace_t *trace;
+    int nthreads;
+    int *seq;        /* for each op, how many earlier ops have its id */
+    int *done;       /* for each id, how many of its ops have been done */
+    pthread_barrier_t start; /* lines up the threads and main */
+} mt_replay_t;
+
+/* One replay thread */
+typedef struct {
+    mt_replay_t *replay;
+    int thread;      /* which shard of the trace this thread replays */
+    hist_t *lat;     /* where to record its latencies */
+    struct timeval start, end; /* when it began and finished its shard */
+} mt_thread_t;
+
+/* Pointer-chasing results for one trace, without and with mm_malloc_near */
+typedef struct {
+    double cycles[2]; /* cycles spent walking the live blocks */
+    double gap[2];   /* average distance between consecutive live blocks */
+} chase_t;
+
+/* One live block in the streaming replay's id map */
+typedef struct {
+    unsigned id;     /* trace id, or IDMAP_EMPTY */
+    int size;        /* requested size */
+    char *p;         /* payload returned by mm */
+} idslot_t;
+
+/* Open-addressing hash map from live ids to blocks, so the streaming
+   replay needs memory for the live blocks only, not for every id */
+typedef struct {
+    idslot_t *slots; /* mask+1 slots, linear probing */
+    unsigned mask;   /* number of slots - 1 */
+    unsigned count;  /* slots in use */
+} idmap_t;
+
+/* The values a grid sweep tries for each tunable, and the range a random
+   sweep draws from: log-uniformly, or 0 for one draw in 8 if lo is 0 */
+static struct {
+    int grid[SWEEP_GRID];
+    int lo, hi;
+} sweep_space[MM_NUM_TUNABLES] = {
+    {{768, 1500, 3000},        528, 8192},    /* MM_SMALL_BLK_SIZE */
+    {{0, 25, 100},             0, 1000},      /* MM_BEST_FIT_THRESHOLD */
+    {{0, 100, 200},            0, 512},       /* MM_SMALL_SIZE */
+    {{0, 8, 32},               0, 256},       /* MM_EXTEND_AHEAD */
+    {{256, 512, 4096},         64, 16384},    /* MM_MIN_CHUNK */
+    {{1<<16, 1<<20, 1<<30},    1<<12, 1<<30}, /* MM_MAX_CHUNK */
+};
+
 /********************
  * Global variables
  *******************/
@@ -92,6 +232,9 @@ int verbose = 0;        /* global flag for verbose output */
 static int errors = 0;  /* number of errs found when running student malloc */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
+/* mm.c isn't thread safe, so the threaded replay serializes its calls */
+static pthread_mutex_t mm_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Directory where default tracefiles are found */
 static char tracedir[MAXLINE] = TRACEDIR;
 
@@ -105,15 +248,16 @@ static char *default_tracefiles[] = {
  * Function prototypes
  *********************/
 
-/* these functions manipulate range lists */
+/* these functions manipulate range trees */
 static int add_range(range_t **ranges, char *lo, int size,
 		     int tracenum, int opnum);
 static void remove_range(range_t **ranges, char *lo);
 static void clear_ranges(range_t **ranges);
-
-/* These functions read, allocate, and free storage for traces */
-static trace_t *read_trace(char *tracedir, char *filename);
-static void free_trace(trace_t *trace);
+static range_t *insert_range(range_t *t, range_t *p);
+static range_t *delete_range(range_t *t, char *lo);
+static range_t *merge_ranges(range_t *a, range_t *b);
+static range_t *alloc_range(void);
+static void free_range(range_t *p);
 
 /* Routines for evaluating the correctness and speed of libc malloc */
 static int eval_libc_valid(trace_t *trace, int tracenum);
@@ -122,12 +266,52 @@ static void eval_libc_speed(void *ptr);
 /* Routines for evaluating correctnes, space utilization, and speed
    of the student's malloc package in mm.c */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges,
+			   char *hints);
+static char *oracle_hints(trace_t *trace);
+static void eval_mm_handles(trace_t *trace, int compact, compact_t *result);
 static void eval_mm_speed(void *ptr);
+static void eval_null_speed(void *ptr);
+static void eval_mm_touch(void *ptr);
+static void eval_sweep(char **tracefiles, int n, char *spec, char *path);
+static int pareto(sweep_t *cfg, int ncfg, int t, int n, double *ops,
+		  double *util, double *kops, int *front);
+static void eval_mm_chase(trace_t *trace, int use_near, chase_t *chase);
+static void eval_mm_stream(char *filename, stats_t *stats);
+static double stream_pass(char *filename, int timed, stats_t *stats);
+static void eval_mm_frag(trace_t *trace, char *filename, int every, int json);
+static void eval_mm_extend(trace_t *trace, extend_t *ext);
+static void eval_mm_latency(trace_t *trace, latency_t *lat);
+static void eval_mm_threads(trace_t *trace, int nthreads, mt_t *mt);
+static void *mt_replay_thread(void *arg);
+static unsigned long long counter_overhead(void);
+
+/* The live-id map used by the streaming replay */
+static void idmap_init(idmap_t *map, unsigned nslots);
+static idslot_t *idmap_find(idmap_t *map, unsigned id);
+static idslot_t *idmap_insert(idmap_t *map, unsigned id);
+static void idmap_remove(idmap_t *map, idslot_t *slot);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void printchase(int n, chase_t *chase);
+static void printoracle(int n, stats_t *stats, double *hint_util);
+static void printcompact(int n, stats_t *stats, compact_t *compact);
+static void printlatency(int n, latency_t *lat);
+static void printthreads(int n, int nthreads, mt_t *mt);
+static void printcounters(int n, stats_t *stats, counters_t *ctrs);
+static void printbench(int n, bench_t *bench);
+static void printnull(int n, stats_t *stats, double *null_secs);
+static void printtouch(int n, stats_t *stats, double *touch_secs);
+static void printextend(int n, stats_t *stats, extend_t *ext);
+static void printinstr(int n, char **tracefiles, stats_t *stats,
+		       mm_instr_t *instr);
+static void printloghist(char *title, unsigned long long *buckets);
+static void writebench(char *path, int n, char **tracefiles, bench_t *bench);
+static void pin_cpu(int cpu);
 static void usage(void);
+static void printpolicy(void);
+static void printmmstats(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
 static void app_error(char *msg);
@@ -144,12 +328,45 @@ int main(int argc, char **argv)
     trace_t *trace = NULL;     /* stores a single trace file in memory */
     range_t *ranges = NULL;    /* keeps track of block extents for one trace */
     stats_t *libc_stats = NULL;/* libc stats for each trace */
-    stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
+    stats_t *mm_results = NULL; /* mm (i.e. student) stats for each trace */
+    chase_t *mm_chase = NULL;  /* pointer-chasing results for each trace */
+    double *hint_util = NULL;  /* util with oracle lifetime hints (-o) */
+    char *hints;               /* per-op lifetime hints for one trace */
+    compact_t *compact_stats = NULL; /* handle replay results (-k) */
+    latency_t *mm_latency = NULL; /* per-op latency histograms (-p) */
+    mt_t *mm_threads = NULL;   /* threaded replay results (-T) */
+    counters_t *mm_counters = NULL; /* hardware counters (-P) */
+    perfctr_t perfctr;         /* the open hardware counters (-P) */
+    bench_t *mm_bench = NULL;  /* per-run throughput (-B) */
+    double *null_secs = NULL;  /* time to replay with a null allocator (-N) */
+    double *touch_secs = NULL; /* time to replay touching payloads (-A) */
+    extend_t *mm_extend = NULL; /* heap extensions and unused tail (-E) */
+    mm_instr_t *mm_instrs = NULL; /* mm.c placement instrumentation (-I) */
+    char *sweep_spec = NULL;   /* "grid" or how many random configs (-s) */
+    char *sweep_file = SWEEP_FILE; /* where the sweep's Pareto front goes (-O) */
+    double *samples = NULL;    /* the times of one trace's runs (-B) */
+    char *bench_file = NULL;   /* where to write the per-run samples (-w) */
     speed_t speed_params;      /* input parameters to the xx_speed routines */
 
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int run_chase = 0;   /* If set, run the pointer-chasing benchmark (-c) */
+    int run_oracle = 0;  /* If set, replay with oracle lifetime hints (-o) */
+    int run_compact = 0; /* If set, replay with handles and mm_compact (-k) */
+    int run_stream = 0;  /* If set, stream the traces instead (-S) */
+    int run_latency = 0; /* If set, time every request (-p) */
+    int run_counters = 0; /* If set, read hardware counters (-P) */
+    int frag_every = 0;  /* If set, sample the heap this often (-F) */
+    int frag_json = 0;   /* If set, write those samples as JSON (-j) */
+    int bench_runs = 0;  /* If set, time each trace this many times (-B) */
+    int cpu = -1;        /* If set, run on this CPU only (-C) */
+    int run_null = 0;    /* If set, time the driver alone as well (-N) */
+    int run_touch = 0;   /* If set, also time a replay that uses the blocks (-A) */
+    int run_extend = 0;  /* If set, count heap extensions (-E) */
+    int run_instr = 0;   /* If set, print mm.c's instrumentation (-I) */
+    int j;
+    int nthreads = 0;    /* If set, replay on this many threads too (-T) */
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -158,7 +375,7 @@ int main(int argc, char **argv)
     /*
      * Read and interpret the command line arguments
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:F:t:T:B:C:w:s:O:hvVgalcokjNpPSAEIx")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -171,6 +388,36 @@ int main(int argc, char **argv)
             tracefiles[0] = strdup(optarg);
             tracefiles[1] = NULL;
             break;
+	case 'F': /* Sample fragmentation every so many ops */
+	    frag_every = atoi(optarg);
+	    if (frag_every < 1) {
+		fprintf(stderr, "-F needs a positive number of ops\n");
+		exit(1);
+	    }
+	    break;
+	case 'B': /* Benchmark mode: time each trace this many times */
+	    bench_runs = atoi(optarg);
+	    if (bench_runs < 2) {
+		fprintf(stderr, "-B needs at least 2 runs\n");
+		exit(1);
+	    }
+	    break;
+	case 'C': /* Pin the driver to one CPU */
+	    cpu = atoi(optarg);
+	    break;
+	case 'w': /* Write the -B samples to this file, for mmcompare */
+	    bench_file = optarg;
+	    break;
+	case 's': /* Sweep the mm.c tunables: "grid", or this many random ones */
+	    if (strcmp(optarg, "grid") != 0 && atoi(optarg) < 1) {
+		fprintf(stderr, "-s needs \"grid\" or a number of configurations\n");
+		exit(1);
+	    }
+	    sweep_spec = optarg;
+	    break;
+	case 'O': /* Write the sweep's Pareto front to this file */
+	    sweep_file = optarg;
+	    break;
 	case 't': /* Directory where the traces are located */
 	    if (num_tracefiles == 1) /* ignore if -f already encountered */
 		break;
@@ -178,12 +425,55 @@ int main(int argc, char **argv)
 	    if (tracedir[strlen(tracedir)-1] != '/')
 		strcat(tracedir, "/"); /* path always ends with "/" */
 	    break;
+	case 'T': /* Replay each trace on this many threads at once */
+	    nthreads = atoi(optarg);
+	    if (nthreads < 1 || nthreads > MAX_THREADS) {
+		fprintf(stderr, "-T needs 1 to %d threads\n", MAX_THREADS);
+		exit(1);
+	    }
+	    break;
+        case 'A': /* Also time a replay that writes and reads the payloads */
+            run_touch = 1;
+            break;
+        case 'E': /* Count heap extensions and the unused tail */
+            run_extend = 1;
+            break;
+        case 'I': /* Print mm.c's find_fit/place/coalesce/realloc histograms */
+            run_instr = 1;
+            break;
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'c': /* Measure locality with and without mm_malloc_near */
+            run_chase = 1;
+            break;
+        case 'o': /* Measure util with oracle lifetime hints */
+            run_oracle = 1;
+            break;
+        case 'k': /* Measure util of handles with and without mm_compact */
+            run_compact = 1;
+            break;
+        case 'j': /* Write the -F samples as JSON instead of CSV */
+            frag_json = 1;
+            break;
+        case 'N': /* Subtract the time of a replay with a null allocator */
+            run_null = 1;
+            break;
+        case 'p': /* Print per-op latency percentiles */
+            run_latency = 1;
+            break;
+        case 'P': /* Read hardware counters while replaying each trace */
+            run_counters = 1;
+            break;
+        case 'S': /* Stream the traces through mm in windows */
+            run_stream = 1;
+            break;
+        case 'x': /* Keep the mm.c tunables fixed: no self-tuning */
+            mm_set_adaptive(0);
+            break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -235,6 +525,10 @@ int main(int argc, char **argv)
 	printf("Using default tracefiles in %s\n", tracedir);
     }
 
+    /* Keep the scheduler from moving us between CPUs mid-measurement */
+    if (cpu >= 0)
+	pin_cpu(cpu);
+
     /* Initialize the timing package */
     init_fsecs();
 
@@ -280,29 +574,145 @@ int main(int argc, char **argv)
 	printf("\nTesting mm malloc\n");
 
     /* Allocate the mm stats array, with one stats_t struct per tracefile */
-    mm_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
-    if (mm_stats == NULL)
-	unix_error("mm_stats calloc in main failed");
+    mm_results = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+    if (mm_results == NULL)
+	unix_error("mm_results calloc in main failed");
+    if (run_chase &&
+	(mm_chase = (chase_t *)calloc(num_tracefiles, sizeof(chase_t))) == NULL)
+	unix_error("mm_chase calloc in main failed");
+    if (run_oracle &&
+	(hint_util = (double *)calloc(num_tracefiles, sizeof(double))) == NULL)
+	unix_error("hint_util calloc in main failed");
+    if (run_compact &&
+	(compact_stats = (compact_t *)calloc(num_tracefiles, sizeof(compact_t))) == NULL)
+	unix_error("compact_stats calloc in main failed");
+    if (run_latency &&
+	(mm_latency = (latency_t *)calloc(num_tracefiles, sizeof(latency_t))) == NULL)
+	unix_error("mm_latency calloc in main failed");
+    if (run_counters) {
+	if ((mm_counters = (counters_t *)calloc(num_tracefiles,
+						sizeof(counters_t))) == NULL)
+	    unix_error("mm_counters calloc in main failed");
+	if (perfctr_open(&perfctr) == 0) {
+	    printf("Hardware counters unavailable (perf_event_open: %s)\n",
+		   strerror(perfctr.err));
+	    free(mm_counters);
+	    mm_counters = NULL;
+	    run_counters = 0;
+	}
+    }
+    if (bench_runs) {
+	if ((mm_bench = (bench_t *)calloc(num_tracefiles, sizeof(bench_t))) == NULL)
+	    unix_error("mm_bench calloc in main failed");
+	if ((samples = (double *)malloc(bench_runs * sizeof(double))) == NULL)
+	    unix_error("samples malloc in main failed");
+    }
+    if (run_touch &&
+	(touch_secs = (double *)calloc(num_tracefiles, sizeof(double))) == NULL)
+	unix_error("touch_secs calloc in main failed");
+    if (run_extend &&
+	(mm_extend = (extend_t *)calloc(num_tracefiles, sizeof(extend_t))) == NULL)
+	unix_error("mm_extend calloc in main failed");
+    if (run_instr) {
+	if ((mm_instrs = (mm_instr_t *)calloc(num_tracefiles,
+					      sizeof(mm_instr_t))) == NULL)
+	    unix_error("mm_instrs calloc in main failed");
+	if (mm_instr(&mm_instrs[0]) < 0) {
+	    printf("mm.c was compiled without MM_INSTRUMENT; rebuild with "
+		   "\"make clean; make MM_INSTRUMENT=1\" for -I\n");
+	    run_instr = 0;
+	}
+    }
+    if (run_null &&
+	(null_secs = (double *)calloc(num_tracefiles, sizeof(double))) == NULL)
+	unix_error("null_secs calloc in main failed");
+    if (nthreads &&
+	(mm_threads = (mt_t *)calloc(num_tracefiles, sizeof(mt_t))) == NULL)
+	unix_error("mm_threads calloc in main failed");
 
     /* Initialize the simulated memory system in memlib.c */
     mem_init();
 
+    /* The sweep replaces the usual evaluation */
+    if (sweep_spec != NULL) {
+	eval_sweep(tracefiles, num_tracefiles, sweep_spec, sweep_file);
+	exit(0);
+    }
+
     /* Evaluate student's mm malloc package using the K-best scheme */
     for (i=0; i < num_tracefiles; i++) {
+	if (run_stream) {
+	    /* One timed pass, never holding the whole trace in memory */
+	    if (verbose > 1)
+		printf("Streaming mm_malloc for efficiency and performance.\n");
+	    eval_mm_stream(tracefiles[i], &mm_results[i]);
+	    continue;
+	}
 	trace = read_trace(tracedir, tracefiles[i]);
-	mm_stats[i].ops = trace->num_ops;
+	mm_results[i].ops = trace->num_ops;
 	if (verbose > 1)
 	    printf("Checking mm_malloc for correctness, ");
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
-	if (mm_stats[i].valid) {
+	mm_results[i].valid = eval_mm_valid(trace, i, &ranges);
+	if (mm_results[i].valid) {
 	    if (verbose > 1)
 		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    mm_results[i].util = eval_mm_util(trace, i, &ranges, NULL);
+	    if (run_instr)
+		mm_instr(&mm_instrs[i]); /* what that one replay recorded */
+	    if (frag_every)
+		eval_mm_frag(trace, tracefiles[i], frag_every, frag_json);
+	    if (run_extend)
+		eval_mm_extend(trace, &mm_extend[i]);
 	    speed_params.trace = trace;
 	    speed_params.ranges = ranges;
 	    if (verbose > 1)
 		printf("and performance.\n");
-	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+	    if (bench_runs) {
+		/* Keep every run; the median stands in for the K-best time */
+		fsecs_samples(eval_mm_speed, &speed_params, BENCH_WARMUP,
+			      bench_runs, samples);
+		mm_results[i].secs = bench_median(samples, bench_runs);
+		mm_bench[i].runs = bench_runs;
+		if ((mm_bench[i].kops = malloc(bench_runs * sizeof(double))) == NULL)
+		    unix_error("mm_bench malloc in main failed");
+		for (j = 0; j < bench_runs; j++)
+		    mm_bench[i].kops[j] = (mm_results[i].ops/1e3) / samples[j];
+	    }
+	    else
+		mm_results[i].secs = fsecs(eval_mm_speed, &speed_params);
+	    if (verbose > 1) {
+		printpolicy();
+		printmmstats();
+	    }
+	    if (run_null)
+		null_secs[i] = fsecs(eval_null_speed, &speed_params);
+	    if (run_touch)
+		touch_secs[i] = fsecs(eval_mm_touch, &speed_params);
+	    if (run_counters) {
+		/* one more, untimed, replay under the counters */
+		perfctr_start(&perfctr);
+		eval_mm_speed(&speed_params);
+		perfctr_stop(&perfctr);
+		memcpy(mm_counters[i].count, perfctr.count,
+		       sizeof(perfctr.count));
+	    }
+	    if (run_chase) {
+		eval_mm_chase(trace, 0, &mm_chase[i]);
+		eval_mm_chase(trace, 1, &mm_chase[i]);
+	    }
+	    if (run_oracle) {
+		hints = oracle_hints(trace);
+		hint_util[i] = eval_mm_util(trace, i, &ranges, hints);
+		free(hints);
+	    }
+	    if (run_compact) {
+		eval_mm_handles(trace, 0, &compact_stats[i]);
+		eval_mm_handles(trace, 1, &compact_stats[i]);
+	    }
+	    if (run_latency)
+		eval_mm_latency(trace, &mm_latency[i]);
+	    if (nthreads)
+		eval_mm_threads(trace, nthreads, &mm_threads[i]);
 	}
 	free_trace(trace);
     }
@@ -310,8 +720,96 @@ int main(int argc, char **argv)
     /* Display the mm results in a compact table */
     if (verbose) {
 	printf("\nResults for mm malloc:\n");
-	printresults(num_tracefiles, mm_stats);
+	printresults(num_tracefiles, mm_results);
+	printf("\n");
+    }
+
+    /* Display the pointer-chasing results */
+    if (run_chase) {
+	printf("Pointer chasing (live blocks walked in allocation order):\n");
+	printchase(num_tracefiles, mm_chase);
+	printf("\n");
+    }
+
+    /* Display the util gained from oracle lifetime hints */
+    if (run_oracle) {
+	printf("Oracle lifetime hints (short-lived: freed within %d ops):\n",
+	       SHORT_LIFETIME);
+	printoracle(num_tracefiles, mm_results, hint_util);
+	printf("\n");
+    }
+
+    /* Display the util of handles before and after compaction */
+    if (run_compact) {
+	printf("Handles (mm_compact for %dus every %d ops):\n",
+	       COMPACT_BUDGET, COMPACT_INTERVAL);
+	printcompact(num_tracefiles, mm_results, compact_stats);
+	printf("\n");
+    }
+
+    /* Display the per-op latency percentiles */
+    if (run_latency) {
+	printf("Latency per request (cycles):\n");
+	printlatency(num_tracefiles, mm_latency);
+	printf("\n");
+    }
+
+    /* Display the cost of using the blocks */
+    if (run_touch) {
+	printf("Replay touching payloads (last %d live blocks read every %d ops):\n",
+	       TOUCH_HOT, TOUCH_INTERVAL);
+	printtouch(num_tracefiles, mm_results, touch_secs);
+	printf("\n");
+    }
+
+    /* Display how often the heap grew and how much of it went unused */
+    if (run_extend) {
+	printf("Heap extensions (unused tail at peak live bytes):\n");
+	printextend(num_tracefiles, mm_results, mm_extend);
+	printf("\n");
+    }
+
+    /* Display where mm.c's searches, splits and merges went */
+    if (run_instr) {
+	printf("Placement instrumentation (one replay of each trace):\n");
+	printinstr(num_tracefiles, tracefiles, mm_results, mm_instrs);
+	printf("\n");
+    }
+
+    /* Display the time spent in the allocator, without the driver's */
+    if (run_null) {
+	printf("Allocator time (driver overhead measured with a null allocator):\n");
+	printnull(num_tracefiles, mm_results, null_secs);
+	printf("\n");
+    }
+
+    /* Display the spread of the benchmark runs */
+    if (bench_runs) {
+	printf("Benchmark (%d runs after %d warmup, %.0f%% bootstrap CI of the median):\n",
+	       bench_runs, BENCH_WARMUP, BENCH_CONF*100);
+	printbench(num_tracefiles, mm_bench);
+	printf("\n");
+	if (bench_file != NULL)
+	    writebench(bench_file, num_tracefiles, tracefiles, mm_bench);
+    }
+
+    /* Display the hardware counters */
+    if (run_counters) {
+	printf("Hardware counters (user mode, one replay per trace):\n");
+	printcounters(num_tracefiles, mm_results, mm_counters);
+	printf("\n");
+	perfctr_close(&perfctr);
+    }
+
+    /* Display the threaded replay results */
+    if (nthreads) {
+	printf("Threaded replay (%d threads, mm calls behind one lock):\n",
+	       nthreads);
+	printthreads(num_tracefiles, nthreads, mm_threads);
 	printf("\n");
+	for (i = 0; i < num_tracefiles; i++)
+	    free(mm_threads[i].lat);
+	free(mm_threads);
     }
 
     /*
@@ -322,10 +820,10 @@ int main(int argc, char **argv)
     util = 0;
     numcorrect = 0;
     for (i=0; i < num_tracefiles; i++) {
-	secs += mm_stats[i].secs;
-	ops += mm_stats[i].ops;
-	util += mm_stats[i].util;
-	if (mm_stats[i].valid)
+	secs += mm_results[i].secs;
+	ops += mm_results[i].ops;
+	util += mm_results[i].util;
+	if (mm_results[i].valid && !mm_results[i].unchecked)
 	    numcorrect++;
     }
     avg_mm_util = util/num_tracefiles;
@@ -333,7 +831,12 @@ int main(int argc, char **argv)
     /*
      * Compute and print the performance index
      */
-    if (errors == 0) {
+    if (run_stream) { /* the index is for allocators known to be correct */
+	perfindex = 0.0;
+	printf("No perf index: streamed traces (-S) aren't checked for "
+	       "correctness\n");
+    }
+    else if (errors == 0) {
 	avg_mm_throughput = ops/secs;
 
 	p1 = UTIL_WEIGHT * avg_mm_util;
@@ -367,22 +870,27 @@ int main(int argc, char **argv)
 
 
 /*****************************************************************
- * The following routines manipulate the range list, which keeps
+ * The following routines manipulate the range tree, which keeps
  * track of the extent of every allocated block payload. We use the
- * range list to detect any overlapping allocated blocks.
+ * range tree to detect any overlapping allocated blocks. It is a
+ * treap keyed on the low address, so adding, checking and removing
+ * a range take O(log n) expected time, and its nodes come from a
+ * pool instead of one malloc each.
  ****************************************************************/
 
+static range_t *range_pool = NULL; /* free range_t records */
+
 /*
  * add_range - As directed by request opnum in trace tracenum,
  *     we've just called the student's mm_malloc to allocate a block of
  *     size bytes at addr lo. After checking the block for correctness,
- *     we create a range struct for this block and add it to the range list.
+ *     we create a range struct for this block and add it to the range tree.
  */
 static int add_range(range_t **ranges, char *lo, int size,
 		     int tracenum, int opnum)
 {
     char *hi = lo + size - 1;
-    range_t *p;
+    range_t *p, *t;
     char msg[MAXLINE];
 
     assert(size > 0);
@@ -404,27 +912,35 @@ static int add_range(range_t **ranges, char *lo, int size,
         return 0;
     }
 
-    /* The payload must not overlap any other payloads */
-    for (p = *ranges;  p != NULL;  p = p->next) {
-        if ((lo >= p->lo && lo <= p-> hi) ||
-            (hi >= p->lo && hi <= p->hi)) {
-	    sprintf(msg, "Payload (%p:%p) overlaps another payload (%p:%p)\n",
-		    lo, hi, p->lo, p->hi);
-	    malloc_error(tracenum, opnum, msg);
-	    return 0;
-        }
+    /*
+     * The payload must not overlap any other payloads. The ranges in
+     * the tree are disjoint, so only the one with the largest low
+     * address <= hi can overlap.
+     */
+    p = NULL;
+    for (t = *ranges;  t != NULL; ) {
+	if (t->lo <= hi) {
+	    p = t;
+	    t = t->right;
+	}
+	else
+	    t = t->left;
+    }
+    if (p != NULL && p->hi >= lo) {
+	sprintf(msg, "Payload (%p:%p) overlaps another payload (%p:%p)\n",
+		lo, hi, p->lo, p->hi);
+	malloc_error(tracenum, opnum, msg);
+	return 0;
     }
 
     /*
      * Everything looks OK, so remember the extent of this block
-     * by creating a range struct and adding it the range list.
+     * by creating a range struct and adding it the range tree.
      */
-    if ((p = (range_t *)malloc(sizeof(range_t))) == NULL)
-	unix_error("malloc error in add_range");
-    p->next = *ranges;
+    p = alloc_range();
     p->lo = lo;
     p->hi = hi;
-    *ranges = p;
+    *ranges = insert_range(*ranges, p);
     return 1;
 }
 
@@ -433,19 +949,7 @@ static int add_range(range_t **ranges, char *lo, int size,
  */
 static void remove_range(range_t **ranges, char *lo)
 {
-    range_t *p;
-    range_t **prevpp = ranges;
-    int size;
-
-    for (p = *ranges;  p != NULL; p = p->next) {
-        if (p->lo == lo) {
-	    *prevpp = p->next;
-            size = p->hi - p->lo + 1;
-            free(p);
-            break;
-        }
-        prevpp = &(p->next);
-    }
+    *ranges = delete_range(*ranges, lo);
 }
 
 /*
@@ -453,117 +957,161 @@ static void remove_range(range_t **ranges, char *lo)
  */
 static void clear_ranges(range_t **ranges)
 {
-    range_t *p;
-    range_t *pnext;
+    range_t *p = *ranges;
 
-    for (p = *ranges;  p != NULL;  p = pnext) {
-        pnext = p->next;
-        free(p);
-    }
+    if (p == NULL)
+	return;
+    clear_ranges(&p->left);
+    clear_ranges(&p->right);
+    free_range(p);
     *ranges = NULL;
 }
 
+/*
+ * insert_range - Insert record p into treap t, returning the new root
+ */
+static range_t *insert_range(range_t *t, range_t *p)
+{
+    range_t *c;
+
+    if (t == NULL)
+	return p;
+    if (p->lo < t->lo) {
+	t->left = insert_range(t->left, p);
+	if (t->left->prio > t->prio) { /* rotate right */
+	    c = t->left;
+	    t->left = c->right;
+	    c->right = t;
+	    return c;
+	}
+    }
+    else {
+	t->right = insert_range(t->right, p);
+	if (t->right->prio > t->prio) { /* rotate left */
+	    c = t->right;
+	    t->right = c->left;
+	    c->left = t;
+	    return c;
+	}
+    }
+    return t;
+}
 
-/**********************************************
- * The following routines manipulate tracefiles
- *********************************************/
+/*
+ * delete_range - Remove and free the record starting at lo from treap t,
+ *     returning the new root
+ */
+static range_t *delete_range(range_t *t, char *lo)
+{
+    range_t *r;
+
+    if (t == NULL)
+	return NULL;
+    if (lo < t->lo)
+	t->left = delete_range(t->left, lo);
+    else if (lo > t->lo)
+	t->right = delete_range(t->right, lo);
+    else {
+	r = merge_ranges(t->left, t->right);
+	free_range(t);
+	return r;
+    }
+    return t;
+}
 
 /*
- * read_trace - read a trace file and store it in memory
+ * merge_ranges - Join treaps a and b, where every range in a is below
+ *     every range in b, returning the new root
  */
-static trace_t *read_trace(char *tracedir, char *filename)
+static range_t *merge_ranges(range_t *a, range_t *b)
 {
-    FILE *tracefile;
-    trace_t *trace;
-    char type[MAXLINE];
-    char path[MAXLINE];
-    unsigned index, size;
-    unsigned max_index = 0;
-    unsigned op_index;
+    if (a == NULL)
+	return b;
+    if (b == NULL)
+	return a;
+    if (a->prio > b->prio) {
+	a->right = merge_ranges(a->right, b);
+	return a;
+    }
+    b->left = merge_ranges(a, b->left);
+    return b;
+}
 
-    if (verbose > 1)
-	printf("Reading tracefile: %s\n", filename);
-
-    /* Allocate the trace record */
-    if ((trace = (trace_t *) malloc(sizeof(trace_t))) == NULL)
-	unix_error("malloc 1 failed in read_trance");
-
-    /* Read the trace file header */
-    strcpy(path, tracedir);
-    strcat(path, filename);
-    if ((tracefile = fopen(path, "r")) == NULL) {
-	sprintf(msg, "Could not open %s in read_trace", path);
-	unix_error(msg);
-    }
-    fscanf(tracefile, "%d", &(trace->sugg_heapsize)); /* not used */
-    fscanf(tracefile, "%d", &(trace->num_ids));
-    fscanf(tracefile, "%d", &(trace->num_ops));
-    fscanf(tracefile, "%d", &(trace->weight));        /* not used */
-
-    /* We'll store each request line in the trace in this array */
-    if ((trace->ops =
-	 (traceop_t *)malloc(trace->num_ops * sizeof(traceop_t))) == NULL)
-	unix_error("malloc 2 failed in read_trace");
-
-    /* We'll keep an array of pointers to the allocated blocks here... */
-    if ((trace->blocks =
-	 (char **)malloc(trace->num_ids * sizeof(char *))) == NULL)
-	unix_error("malloc 3 failed in read_trace");
-
-    /* ... along with the corresponding byte sizes of each block */
-    if ((trace->block_sizes =
-	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
-	unix_error("malloc 4 failed in read_trace");
-
-    /* read every request line in the trace file */
-    index = 0;
-    op_index = 0;
-    while (fscanf(tracefile, "%s", type) != EOF) {
-	switch(type[0]) {
-	case 'a':
-	    fscanf(tracefile, "%u %u", &index, &size);
-	    trace->ops[op_index].type = ALLOC;
-	    trace->ops[op_index].index = index;
-	    trace->ops[op_index].size = size;
-	    max_index = (index > max_index) ? index : max_index;
-	    break;
-	case 'r':
-	    fscanf(tracefile, "%u %u", &index, &size);
-	    trace->ops[op_index].type = REALLOC;
-	    trace->ops[op_index].index = index;
-	    trace->ops[op_index].size = size;
-	    max_index = (index > max_index) ? index : max_index;
-	    break;
-	case 'f':
-	    fscanf(tracefile, "%ud", &index);
-	    trace->ops[op_index].type = FREE;
-	    trace->ops[op_index].index = index;
-	    break;
-	default:
-	    printf("Bogus type character (%c) in tracefile %s\n",
-		   type[0], path);
-	    exit(1);
-	}
-	op_index++;
+/*
+ * alloc_range - Get a range record from the pool, refilling the pool
+ *     with a new chunk of RANGE_CHUNK records when it is empty
+ */
+static range_t *alloc_range(void)
+{
+    static unsigned seed = 2463534242u;
+    range_t *p;
+    int i;
 
+    if (range_pool == NULL) {
+	if ((p = (range_t *)malloc(RANGE_CHUNK * sizeof(range_t))) == NULL)
+	    unix_error("malloc error in alloc_range");
+	for (i = 0; i < RANGE_CHUNK; i++)
+	    free_range(&p[i]);
     }
-    fclose(tracefile);
-    assert(max_index == trace->num_ids - 1);
-    assert(trace->num_ops == op_index);
+    p = range_pool;
+    range_pool = p->right;
+
+    seed ^= seed << 13; /* xorshift */
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    p->prio = seed;
+    p->left = p->right = NULL;
+    return p;
+}
 
-    return trace;
+/*
+ * free_range - Return a range record to the pool
+ */
+static void free_range(range_t *p)
+{
+    p->right = range_pool;
+    range_pool = p;
 }
 
+
+/**********************************************
+ * The following routines analyze tracefiles
+ * (reading them is done in trace.c)
+ *********************************************/
+
 /*
- * free_trace - Free the trace record and the three arrays it points
- *              to, all of which were allocated in read_trace().
+ * oracle_hints - Derive a lifetime hint for every op in the trace by
+ *     looking ahead to when each block is freed. Allocations freed within
+ *     SHORT_LIFETIME ops get MM_SHORT_LIVED, the rest MM_LONG_LIVED.
+ *     Returns a malloc'd array with one hint per op.
  */
-void free_trace(trace_t *trace)
+static char *oracle_hints(trace_t *trace)
 {
-    free(trace->ops);         /* free the three arrays... */
-    free(trace->blocks);
-    free(trace->block_sizes);
-    free(trace);              /* and the trace record itself... */
+    int i;
+    int *born;
+    char *hints;
+
+    if ((hints = (char *)calloc(trace->num_ops, sizeof(char))) == NULL)
+	unix_error("calloc 1 failed in oracle_hints");
+    if ((born = (int *)malloc(trace->num_ids * sizeof(int))) == NULL)
+	unix_error("malloc 2 failed in oracle_hints");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    born[trace->ops[i].index] = i;
+	    hints[i] = MM_LONG_LIVED;
+	    break;
+	case FREE:
+	    if (i - born[trace->ops[i].index] < SHORT_LIFETIME)
+		hints[born[trace->ops[i].index]] = MM_SHORT_LIVED;
+	    break;
+	default:
+	    break;
+	}
+    }
+    free(born);
+    return hints;
 }
 
 /**********************************************************************
@@ -584,7 +1132,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
     char *oldp;
     char *p;
 
-    /* Reset the heap and free any records in the range list */
+    /* Reset the heap and free any records in the range tree */
     mem_reset_brk();
     clear_ranges(ranges);
 
@@ -611,7 +1159,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 
 	    /*
 	     * Test the range of the new block for correctness and add it
-	     * to the range list if OK. The block must be  be aligned properly,
+	     * to the range tree if OK. The block must be  be aligned properly,
 	     * and must not overlap any currently allocated block.
 	     */
 	    if (add_range(ranges, p, size, tracenum, i) == 0)
@@ -638,10 +1186,10 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 		return 0;
 	    }
 
-	    /* Remove the old region from the range list */
+	    /* Remove the old region from the range tree */
 	    remove_range(ranges, oldp);
 
-	    /* Check new block for correctness and add it to range list */
+	    /* Check new block for correctness and add it to range tree */
 	    if (add_range(ranges, newp, size, tracenum, i) == 0)
 		return 0;
 
@@ -653,7 +1201,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 	    if (size < oldsize) oldsize = size;
 	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
+	      if ((unsigned char)newp[j] != (index & 0xFF)) {
 		malloc_error(tracenum, i, "mm_realloc did not preserve the "
 			     "data from old block");
 		return 0;
@@ -668,7 +1216,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 
         case FREE: /* mm_free */
 
-	    /* Remove region from list and call student's free function */
+	    /* Remove region from tree and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
 	    mm_free(p);
@@ -694,8 +1242,11 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
  *   doesn't allow the students to decrement the brk pointer, so brk
  *   is always the high water mark of the heap.
  *
+ *   If hints is not NULL, each mm_malloc is replaced by mm_malloc_hint
+ *   with the lifetime hint for that op.
  */
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges,
+			   char *hints)
 {
     int i;
     int index;
@@ -717,7 +1268,11 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL)
+	    if (hints != NULL)
+		p = mm_malloc_hint(size, hints[i]);
+	    else
+		p = mm_malloc(size);
+	    if (p == NULL)
 		app_error("mm_malloc failed in eval_mm_util");
 
 	    /* Remember region and size */
@@ -779,6 +1334,159 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 }
 
 
+/*
+ * eval_mm_frag - Replay the trace as eval_mm_util does, and every "every"
+ *   ops (and after the last one) record the live payload, the heap size
+ *   and the free space mm_freespace reports. The external fragmentation
+ *   index is 1 - largest free block / free bytes: 0 when all the free
+ *   space is one block, near 1 when it is in many small pieces. The
+ *   samples go to <trace>.frag.csv, or <trace>.frag.json with -j, in the
+ *   current directory, named after the trace file without its suffix.
+ */
+static void eval_mm_frag(trace_t *trace, char *filename, int every, int json)
+{
+    int i, index, size;
+    long long live = 0;
+    char path[MAXLINE], *base, *dot;
+    char *p;
+    FILE *fp;
+    mm_freespace_t fs;
+    double index_ext;
+
+    /* Name the output after the trace: dir/short1-bal.rep -> short1-bal */
+    base = strrchr(filename, '/');
+    base = (base != NULL) ? base + 1 : filename;
+    snprintf(path, sizeof(path), "%s", base);
+    if ((dot = strrchr(path, '.')) != NULL && dot != path)
+	*dot = '\0';
+    strncat(path, json ? ".frag.json" : ".frag.csv",
+	    sizeof(path) - strlen(path) - 1);
+    if ((fp = fopen(path, "w")) == NULL)
+	unix_error(path);
+
+    if (json)
+	fprintf(fp, "{\"trace\": \"%s\", \"every\": %d, \"samples\": [\n",
+		base, every);
+    else
+	fprintf(fp, "op,live,heap,free,free_blocks,largest_free,ext_frag\n");
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_frag");
+
+    for (i = 0; i <= trace->num_ops; i++) {
+	if (i % every == 0 || i == trace->num_ops) {
+	    mm_freespace(&fs);
+	    index_ext = (fs.free_bytes == 0) ? 0 :
+		1.0 - (double)fs.largest_free / (double)fs.free_bytes;
+	    if (json)
+		fprintf(fp, "%s  {\"op\": %d, \"live\": %lld, \"heap\": %lu, "
+			"\"free\": %lu, \"free_blocks\": %lu, "
+			"\"largest_free\": %lu, \"ext_frag\": %.4f}",
+			(i == 0) ? "" : ",\n", i, live,
+			(unsigned long)mem_heapsize(),
+			(unsigned long)fs.free_bytes,
+			(unsigned long)fs.free_blocks,
+			(unsigned long)fs.largest_free, index_ext);
+	    else
+		fprintf(fp, "%d,%lld,%lu,%lu,%lu,%lu,%.4f\n", i, live,
+			(unsigned long)mem_heapsize(),
+			(unsigned long)fs.free_bytes,
+			(unsigned long)fs.free_blocks,
+			(unsigned long)fs.largest_free, index_ext);
+	}
+	if (i == trace->num_ops)
+	    break;
+
+	index = trace->ops[i].index;
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    size = trace->ops[i].size;
+	    if ((p = mm_malloc(size)) == NULL)
+		app_error("mm_malloc failed in eval_mm_frag");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    live += size;
+	    break;
+	case REALLOC:
+	    size = trace->ops[i].size;
+	    if ((p = mm_realloc(trace->blocks[index], size)) == NULL)
+		app_error("mm_realloc failed in eval_mm_frag");
+	    trace->blocks[index] = p;
+	    live += size - trace->block_sizes[index];
+	    trace->block_sizes[index] = size;
+	    break;
+	case FREE:
+	    mm_free(trace->blocks[index]);
+	    live -= trace->block_sizes[index];
+	    break;
+	default:
+	    app_error("Nonexistent request type in eval_mm_frag");
+	}
+    }
+
+    if (json)
+	fprintf(fp, "\n]}\n");
+    fclose(fp);
+    if (verbose > 1)
+	printf("fragmentation (%s), ", path);
+}
+
+/*
+ * eval_mm_extend - Replay the trace as eval_mm_util does, and count the
+ *   heap extensions. When the live bytes peak -- where util is measured --
+ *   take the heap size and the free space at its end: bytes the heap was
+ *   extended by that no request needed.
+ */
+static void eval_mm_extend(trace_t *trace, extend_t *ext)
+{
+    int i, index, size;
+    long long live = 0, max_live = 0;
+    char *p;
+    mm_freespace_t fs;
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_extend");
+
+    ext->heap = ext->tail = 0;
+    for (i = 0; i < trace->num_ops; i++) {
+	index = trace->ops[i].index;
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	    size = trace->ops[i].size;
+	    if ((p = mm_malloc(size)) == NULL)
+		app_error("mm_malloc failed in eval_mm_extend");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    live += size;
+	    break;
+	case REALLOC:
+	    size = trace->ops[i].size;
+	    if ((p = mm_realloc(trace->blocks[index], size)) == NULL)
+		app_error("mm_realloc failed in eval_mm_extend");
+	    trace->blocks[index] = p;
+	    live += size - trace->block_sizes[index];
+	    trace->block_sizes[index] = size;
+	    break;
+	case FREE:
+	    mm_free(trace->blocks[index]);
+	    live -= trace->block_sizes[index];
+	    break;
+	default:
+	    app_error("Nonexistent request type in eval_mm_extend");
+	}
+	if (live > max_live) {
+	    max_live = live;
+	    mm_freespace(&fs);
+	    ext->heap = mem_heapsize();
+	    ext->tail = fs.tail_free;
+	}
+    }
+    mm_freespace(&fs);
+    ext->extends = fs.extends;
+}
+
 /*
  * eval_mm_speed - This is the function that is used by fcyc()
  *    to measure the running time of the mm malloc package.
@@ -827,26 +1535,955 @@ static void eval_mm_speed(void *ptr)
 }
 
 /*
- * eval_libc_valid - We run this function to make sure that the
- *    libc malloc can run to completion on the set of traces.
- *    We'll be conservative and terminate if any libc malloc call fails.
- *
+ * eval_mm_touch - eval_mm_speed for an allocator whose blocks are used:
+ *    each payload is filled when it is allocated (a realloc fills the
+ *    part that grew), and every TOUCH_INTERVAL ops the first TOUCH_LINES
+ *    cache lines of the most recently allocated live blocks are read
+ *    back. The traces don't record their programs' accesses, so this
+ *    stands in for them: objects allocated together are used together.
+ *    An allocator that packs those objects into fewer lines and pages
+ *    does fewer misses here, where eval_mm_speed can't tell.
  */
-static int eval_libc_valid(trace_t *trace, int tracenum)
+static unsigned touch_sink; /* keeps the reads from being optimized away */
+
+static void eval_mm_touch(void *ptr)
 {
-    int i, newsize;
-    char *p, *newp, *oldp;
+    int i, j, index, size, oldsize, lines;
+    int hot[TOUCH_HOT];  /* ids of the last TOUCH_HOT blocks allocated */
+    int next_hot = 0;    /* where the next id goes in hot[], round robin */
+    unsigned sum = 0;
+    char *p;
+    trace_t *trace = ((speed_t *)ptr)->trace;
+
+    for (j = 0; j < TOUCH_HOT; j++)
+	hot[j] = -1;
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_touch");
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
 
-        case ALLOC: /* malloc */
-	    if ((p = malloc(trace->ops[i].size)) == NULL) {
-		malloc_error(tracenum, i, "libc malloc failed");
-		unix_error("System message");
-	    }
-	    trace->blocks[trace->ops[i].index] = p;
-	    break;
+        case ALLOC:
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_malloc(size)) == NULL)
+		app_error("mm_malloc error in eval_mm_touch");
+	    memset(p, index & 0xFF, size);
+            trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
+	    hot[next_hot] = index;
+	    next_hot = (next_hot + 1) % TOUCH_HOT;
+            break;
+
+	case REALLOC:
+	    index = trace->ops[i].index;
+            size = trace->ops[i].size;
+	    oldsize = trace->block_sizes[index];
+            if ((p = mm_realloc(trace->blocks[index], size)) == NULL)
+		app_error("mm_realloc error in eval_mm_touch");
+	    if (size > oldsize)
+		memset(p + oldsize, index & 0xFF, size - oldsize);
+            trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
+            break;
+
+        case FREE:
+            index = trace->ops[i].index;
+            mm_free(trace->blocks[index]);
+            trace->blocks[index] = NULL; /* drops it from hot[] */
+            break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_touch");
+        }
+
+	if (i % TOUCH_INTERVAL == TOUCH_INTERVAL - 1) {
+	    for (j = 0; j < TOUCH_HOT; j++) {
+		if (hot[j] < 0 || (p = trace->blocks[hot[j]]) == NULL)
+		    continue;
+		size = trace->block_sizes[hot[j]];
+		for (lines = 0; lines < TOUCH_LINES && size > 0; lines++) {
+		    sum += (unsigned char)*p;
+		    p += CACHE_LINE;
+		    size -= CACHE_LINE;
+		}
+	    }
+	}
+    }
+    touch_sink += sum;
+}
+
+/*
+ * eval_sweep - Replay every trace under many configurations of the mm.c
+ *   tunables: the defaults, then either every combination of the
+ *   sweep_space grid (spec "grid") or spec random draws from its ranges.
+ *   Each configuration is checked with eval_mm_valid and scored by util
+ *   and Kops on each trace. The configurations no other one beats on
+ *   both util and Kops -- the Pareto front -- are written to path as CSV,
+ *   for each trace and for the whole set (average util, total Kops).
+ *   Self-tuning is off, so each configuration is scored as given.
+ */
+static void eval_sweep(char **tracefiles, int n, char *spec, char *path)
+{
+    trace_t **traces;
+    sweep_t *cfg;
+    range_t *ranges = NULL;
+    speed_t speed;
+    double samples[SWEEP_RUNS], *ops, *util, *kops, u, lo;
+    int *front;
+    int ncfg, c, i, k, t, nfront, rest;
+    unsigned long long seed = 88172645463325252ULL;
+    FILE *fp;
+
+    /* Load the traces once for all the configurations */
+    if ((traces = (trace_t **)malloc(n * sizeof(trace_t *))) == NULL ||
+	(ops = (double *)malloc(n * sizeof(double))) == NULL)
+	unix_error("traces malloc in eval_sweep failed");
+    for (i = 0; i < n; i++) {
+	traces[i] = read_trace(tracedir, tracefiles[i]);
+	ops[i] = traces[i]->num_ops;
+    }
+
+    /* Configuration 0 is the defaults; then the grid or the random draws */
+    if (strcmp(spec, "grid") == 0)
+	for (ncfg = 1, k = 0; k < MM_NUM_TUNABLES; k++)
+	    ncfg *= SWEEP_GRID;
+    else
+	ncfg = atoi(spec);
+    ncfg++;
+    if ((cfg = (sweep_t *)calloc(ncfg, sizeof(sweep_t))) == NULL)
+	unix_error("cfg calloc in eval_sweep failed");
+    for (c = 0; c < ncfg; c++) {
+	for (k = 0; k < MM_NUM_TUNABLES; k++) {
+	    if (c == 0)
+		cfg[c].tune[k] = mm_get_tunable(k);
+	    else if (strcmp(spec, "grid") == 0) {
+		/* digit k of c-1 in base SWEEP_GRID picks the value */
+		for (rest = c - 1, i = 0; i < k; i++)
+		    rest /= SWEEP_GRID;
+		cfg[c].tune[k] = sweep_space[k].grid[rest % SWEEP_GRID];
+	    }
+	    else {
+		seed ^= seed >> 12; /* xorshift64* */
+		seed ^= seed << 25;
+		seed ^= seed >> 27;
+		u = ((seed * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+		if (sweep_space[k].lo == 0 && u < 0.125)
+		    cfg[c].tune[k] = 0;
+		else {
+		    /* log-uniform on [lo, hi], from 8 if lo is 0 */
+		    if (sweep_space[k].lo == 0)
+			u = (u - 0.125) / 0.875;
+		    lo = (sweep_space[k].lo > 8) ? sweep_space[k].lo : 8;
+		    cfg[c].tune[k] = (int)(lo * pow(sweep_space[k].hi / lo, u)) & ~7;
+		    if (cfg[c].tune[k] < sweep_space[k].lo)
+			cfg[c].tune[k] = sweep_space[k].lo;
+		}
+	    }
+	}
+	if ((cfg[c].util = (double *)calloc(n, sizeof(double))) == NULL ||
+	    (cfg[c].secs = (double *)calloc(n, sizeof(double))) == NULL)
+	    unix_error("cfg calloc in eval_sweep failed");
+    }
+
+    /* Score every configuration on every trace */
+    mm_set_adaptive(0);
+    printf("Sweeping %d configurations of the mm.c tunables over %d traces\n",
+	   ncfg, n);
+    for (c = 0; c < ncfg; c++) {
+	for (k = 0; k < MM_NUM_TUNABLES; k++)
+	    if (mm_set_tunable(k, cfg[c].tune[k]) < 0)
+		app_error("mm_set_tunable failed in eval_sweep");
+	cfg[c].valid = 1;
+	for (i = 0; i < n && cfg[c].valid; i++) {
+	    if (!eval_mm_valid(traces[i], i, &ranges)) {
+		cfg[c].valid = 0;
+		break;
+	    }
+	    cfg[c].util[i] = eval_mm_util(traces[i], i, &ranges, NULL);
+	    speed.trace = traces[i];
+	    speed.ranges = ranges;
+	    fsecs_samples(eval_mm_speed, &speed, 1, SWEEP_RUNS, samples);
+	    cfg[c].secs[i] = bench_median(samples, SWEEP_RUNS);
+	}
+	if (verbose > 1)
+	    printf("configuration %d of %d%s\n", c + 1, ncfg,
+		   cfg[c].valid ? "" : ": not valid");
+    }
+    for (k = 0; k < MM_NUM_TUNABLES; k++)
+	mm_set_tunable(k, cfg[0].tune[k]);
+
+    /* Write the Pareto front of each trace, then of the whole set */
+    if ((util = (double *)malloc(ncfg * sizeof(double))) == NULL ||
+	(kops = (double *)malloc(ncfg * sizeof(double))) == NULL ||
+	(front = (int *)malloc(ncfg * sizeof(int))) == NULL)
+	unix_error("malloc in eval_sweep failed");
+    if ((fp = fopen(path, "w")) == NULL)
+	unix_error(path);
+    fprintf(fp, "trace,util,kops");
+    for (k = 0; k < MM_NUM_TUNABLES; k++)
+	fprintf(fp, ",%s", mm_tunable_name(k));
+    fprintf(fp, ",default\n");
+    for (t = 0; t <= n; t++) {
+	nfront = pareto(cfg, ncfg, t, n, ops, util, kops, front);
+	for (i = 0; i < nfront; i++) {
+	    c = front[i];
+	    fprintf(fp, "%s,%.4f,%.0f", (t < n) ? tracefiles[t] : "all",
+		    util[c], kops[c]);
+	    for (k = 0; k < MM_NUM_TUNABLES; k++)
+		fprintf(fp, ",%d", cfg[c].tune[k]);
+	    fprintf(fp, ",%d\n", c == 0);
+	}
+    }
+    if (fclose(fp) != 0)
+	unix_error(path);
+
+    /* Show the front for the whole set */
+    printf("\nPareto front over all traces (* = the defaults), also in %s:\n",
+	   path);
+    printf("%6s%8s", "util", "Kops");
+    for (k = 0; k < MM_NUM_TUNABLES; k++)
+	printf(" %s", mm_tunable_name(k));
+    printf("\n");
+    nfront = pareto(cfg, ncfg, n, n, ops, util, kops, front);
+    for (i = 0; i < nfront; i++) {
+	c = front[i];
+	printf("%5.1f%%%8.0f", util[c]*100.0, kops[c]);
+	for (k = 0; k < MM_NUM_TUNABLES; k++)
+	    printf(" %*d", (int)strlen(mm_tunable_name(k)), cfg[c].tune[k]);
+	printf("%s\n", c == 0 ? " *" : "");
+    }
+    if (cfg[0].valid)
+	printf("Defaults: %.1f%% util, %.0f Kops\n", util[0]*100.0, kops[0]);
+
+    for (c = 0; c < ncfg; c++) {
+	free(cfg[c].util);
+	free(cfg[c].secs);
+    }
+    free(cfg);
+    free(util);
+    free(kops);
+    free(front);
+    for (i = 0; i < n; i++)
+	free_trace(traces[i]);
+    free(traces);
+    free(ops);
+}
+
+/*
+ * pareto - Score each valid configuration on trace t (or on the whole
+ *   set if t == n) into util[] and kops[], and store the indices of the
+ *   ones on the Pareto front in front[], in increasing order of Kops.
+ *   Returns the size of the front.
+ */
+static int pareto(sweep_t *cfg, int ncfg, int t, int n, double *ops,
+		  double *util, double *kops, int *front)
+{
+    int c, d, i, nfront = 0;
+    double secs, tops;
+
+    for (c = 0; c < ncfg; c++) {
+	if (!cfg[c].valid)
+	    continue;
+	if (t < n) {
+	    util[c] = cfg[c].util[t];
+	    kops[c] = (ops[t]/1e3) / cfg[c].secs[t];
+	}
+	else {
+	    util[c] = secs = tops = 0;
+	    for (i = 0; i < n; i++) {
+		util[c] += cfg[c].util[i] / n;
+		secs += cfg[c].secs[i];
+		tops += ops[i];
+	    }
+	    kops[c] = (tops/1e3) / secs;
+	}
+    }
+
+    for (c = 0; c < ncfg; c++) {
+	if (!cfg[c].valid)
+	    continue;
+	for (d = 0; d < ncfg; d++)
+	    if (cfg[d].valid && util[d] >= util[c] && kops[d] >= kops[c] &&
+		(util[d] > util[c] || kops[d] > kops[c]))
+		break;
+	if (d < ncfg) /* dominated by d */
+	    continue;
+	for (i = nfront; i > 0 && kops[front[i-1]] > kops[c]; i--)
+	    front[i] = front[i-1];
+	front[i] = c;
+	nfront++;
+    }
+    return nfront;
+}
+
+/*
+ * The null allocator replayed by eval_null_speed: a bump pointer that
+ *    never reuses or touches memory. Its calls are kept out of line, like
+ *    the calls into mm.c, so the replay costs what eval_mm_speed's does
+ *    apart from the work inside mm_malloc, mm_free and mm_realloc.
+ */
+static unsigned long null_brk;
+
+static void *null_malloc(size_t size) __attribute__((noinline));
+static void null_free(void *ptr) __attribute__((noinline));
+static void *null_realloc(void *ptr, size_t size) __attribute__((noinline));
+
+static void *null_malloc(size_t size)
+{
+    void *p = (void *)null_brk;
+
+    null_brk += (size + ALIGNMENT-1) & ~(ALIGNMENT-1);
+    return p;
+}
+
+static void null_free(void *ptr)
+{
+    asm volatile("" : : "r" (ptr) : "memory"); /* not a no-op to gcc */
+}
+
+static void *null_realloc(void *ptr, size_t size)
+{
+    null_free(ptr);
+    return null_malloc(size);
+}
+
+/*
+ * eval_null_speed - eval_mm_speed with the null allocator, to time the
+ *    driver's own share of eval_mm_speed: decoding the trace, indexing
+ *    the blocks array and dispatching on the request type
+ */
+static void eval_null_speed(void *ptr)
+{
+    int i, index, size, newsize;
+    char *p, *newp, *oldp, *block;
+    trace_t *trace = ((speed_t *)ptr)->trace;
+
+    /* Reset the heap as eval_mm_speed does; start above address 0 so no
+       block comes back NULL */
+    mem_reset_brk();
+    null_brk = (unsigned long)mem_heap_lo() + ALIGNMENT;
+
+    for (i = 0;  i < trace->num_ops;  i++)
+        switch (trace->ops[i].type) {
+
+        case ALLOC:
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = null_malloc(size)) == NULL)
+		app_error("null_malloc error in eval_null_speed");
+            trace->blocks[index] = p;
+            break;
+
+	case REALLOC:
+	    index = trace->ops[i].index;
+            newsize = trace->ops[i].size;
+	    oldp = trace->blocks[index];
+            if ((newp = null_realloc(oldp,newsize)) == NULL)
+		app_error("null_realloc error in eval_null_speed");
+            trace->blocks[index] = newp;
+            break;
+
+        case FREE:
+            index = trace->ops[i].index;
+            block = trace->blocks[index];
+            null_free(block);
+            break;
+
+	default:
+	    app_error("Nonexistent request type in eval_null_speed");
+        }
+}
+
+/*
+ * eval_mm_handles - Replay the trace with mm_halloc/mm_hrealloc/mm_hfree
+ *    and compute space utilization as in eval_mm_util. If compact is set,
+ *    mm_compact is given COMPACT_BUDGET usecs every COMPACT_INTERVAL ops.
+ *    Each object is filled with the low byte of its id and checked before
+ *    it is resized or freed, to catch compaction corrupting a block.
+ *    Results go in result->util[compact] and result->moved.
+ */
+static void eval_mm_handles(trace_t *trace, int compact, compact_t *result)
+{
+    int i, j, index, size, oldsize;
+    int total_size = 0, max_total_size = 0;
+    mm_handle_t *handles;
+    char *p;
+
+    if ((handles = (mm_handle_t *)malloc(trace->num_ids * sizeof(mm_handle_t))) == NULL)
+	unix_error("malloc failed in eval_mm_handles");
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_handles");
+
+    if (compact)
+	result->moved = 0;
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+	oldsize = trace->block_sizes[index];
+
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_halloc */
+	    if ((handles[index] = mm_halloc(size)) == MM_NULL_HANDLE)
+		app_error("mm_halloc failed in eval_mm_handles");
+	    memset(mm_hlock(handles[index]), index & 0xFF, size);
+	    mm_hunlock(handles[index]);
+	    trace->block_sizes[index] = size;
+	    total_size += size;
+	    break;
+
+	case REALLOC: /* mm_hrealloc */
+	    if (mm_hrealloc(handles[index], size) == MM_NULL_HANDLE)
+		app_error("mm_hrealloc failed in eval_mm_handles");
+	    p = mm_hlock(handles[index]);
+	    for (j = 0; j < size && j < oldsize; j++)
+		if (p[j] != (char)(index & 0xFF))
+		    app_error("mm_hrealloc did not preserve the data");
+	    memset(p, index & 0xFF, size);
+	    mm_hunlock(handles[index]);
+	    trace->block_sizes[index] = size;
+	    total_size += size - oldsize;
+	    break;
+
+        case FREE: /* mm_hfree */
+	    p = mm_hlock(handles[index]);
+	    for (j = 0; j < oldsize; j++)
+		if (p[j] != (char)(index & 0xFF))
+		    app_error("mm_compact did not preserve the data");
+	    mm_hunlock(handles[index]);
+	    mm_hfree(handles[index]);
+	    total_size -= oldsize;
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_handles");
+        }
+
+	max_total_size = (total_size > max_total_size) ?
+	    total_size : max_total_size;
+	if (compact && i % COMPACT_INTERVAL == COMPACT_INTERVAL - 1)
+	    result->moved += mm_compact(COMPACT_BUDGET);
+    }
+
+    result->util[compact] = (double)max_total_size / (double)mem_heapsize();
+    free(handles);
+}
+
+/*
+ * eval_mm_chase - Measure how well related blocks are co-located.
+ *    Each block is treated as the child of the block allocated just
+ *    before it, so the allocation graph is the order of the ids. Every
+ *    CHASE_INTERVAL ops the live blocks are walked in that order, touching
+ *    one word in each, and the walk is timed. With use_near set, each
+ *    mm_malloc is replaced by mm_malloc_near on the previous live block:
+ *    the last one allocated, or once that is freed, the live block with
+ *    the next lower id.
+ *    Results go in chase->cycles[use_near] and chase->gap[use_near].
+ */
+static void eval_mm_chase(trace_t *trace, int use_near, chase_t *chase)
+{
+    int i, id, index, last = -1;
+    char *p, *prev;
+    char *live;
+    double gap = 0, steps = 0;
+    volatile int sum = 0;
+    unsigned long long start, cycles, ovhd;
+
+    ovhd = counter_overhead();
+
+    if ((live = (char *)calloc(trace->num_ids, sizeof(char))) == NULL)
+	unix_error("calloc failed in eval_mm_chase");
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_chase");
+
+    chase->cycles[use_near] = 0;
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_malloc or mm_malloc_near */
+	    if (use_near)
+		p = mm_malloc_near((last < 0) ? NULL : trace->blocks[last],
+				   trace->ops[i].size);
+	    else
+		p = mm_malloc(trace->ops[i].size);
+	    if (p == NULL)
+		app_error("mm_malloc failed in eval_mm_chase");
+	    trace->blocks[index] = p;
+	    live[index] = 1;
+	    last = index;
+	    break;
+
+	case REALLOC: /* mm_realloc */
+	    p = mm_realloc(trace->blocks[index], trace->ops[i].size);
+	    if (p == NULL)
+		app_error("mm_realloc failed in eval_mm_chase");
+	    trace->blocks[index] = p;
+	    break;
+
+        case FREE: /* mm_free */
+	    mm_free(trace->blocks[index]);
+	    live[index] = 0;
+	    while (last >= 0 && !live[last])
+		last--;
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_chase");
+        }
+
+	if (i % CHASE_INTERVAL != CHASE_INTERVAL - 1)
+	    continue;
+
+	/* Walk the live blocks in allocation order; a walk takes well under
+	   a microsecond on a small heap, so it's timed with the cycle counter */
+	start = read_counter();
+	for (id = 0; id < trace->num_ids; id++)
+	    if (live[id])
+		sum += *(int *)trace->blocks[id];
+	cycles = read_counter() - start;
+	chase->cycles[use_near] += (cycles > ovhd) ? cycles - ovhd : 0;
+
+	/* ...and measure how far apart consecutive blocks are */
+	prev = NULL;
+	for (id = 0; id < trace->num_ids; id++) {
+	    if (!live[id])
+		continue;
+	    if (prev != NULL) {
+		gap += (trace->blocks[id] > prev) ?
+		    trace->blocks[id] - prev : prev - trace->blocks[id];
+		steps++;
+	    }
+	    prev = trace->blocks[id];
+	}
+    }
+    chase->gap[use_near] = (steps > 0) ? gap / steps : 0;
+    free(live);
+}
+
+/*
+ * eval_mm_stream - Replay a trace through mm one window at a time, for
+ *    traces too big for read_trace. The trace is read ahead by a thread
+ *    in trace.c, and live blocks are kept in an idmap_t, so memory use is
+ *    bounded by the window size and the number of live blocks.
+ *
+ *    The trace is streamed 1 + STREAM_TIMED times. The first pass is
+ *    untimed: it measures util and faults in the heap pages, which
+ *    eval_mm_speed finds warm after eval_mm_valid and eval_mm_util. The
+ *    others time only the mm calls, with the cycle counter, so the id
+ *    map, the disk and the rest of the driver are left out; a pass's
+ *    cycles are turned into seconds at the rate the counter ran over the
+ *    whole pass, and the fastest pass counts, a short K-best. The
+ *    payloads aren't checked as in eval_mm_valid, so stats->unchecked is
+ *    set.
+ */
+static void eval_mm_stream(char *filename, stats_t *stats)
+{
+    double cycles, secs;
+    struct timeval stv, etv;
+    unsigned long long start;
+    int k;
+
+    stream_pass(filename, 0, stats);
+    for (k = 0; k < STREAM_TIMED; k++) {
+	start = read_counter();
+	gettimeofday(&stv, NULL);
+	cycles = stream_pass(filename, 1, stats);
+	gettimeofday(&etv, NULL);
+	secs = (etv.tv_sec - stv.tv_sec) + 1E-6*(etv.tv_usec - stv.tv_usec);
+	secs = cycles * secs / (double)(read_counter() - start);
+	if (k == 0 || secs < stats->secs)
+	    stats->secs = secs;
+    }
+    stats->valid = 1;
+    stats->unchecked = 1;
+}
+
+/*
+ * stream_pass - one streamed replay of a trace for eval_mm_stream. The
+ *    untimed pass fills in stats->ops and stats->util; the timed one
+ *    returns the cycles spent in mm_malloc, mm_realloc and mm_free.
+ */
+static double stream_pass(char *filename, int timed, stats_t *stats)
+{
+    trace_t header;
+    trace_stream_t *stream;
+    traceop_t *ops;
+    idmap_t live;
+    idslot_t *slot;
+    int i, n;
+    long total_size = 0, max_total_size = 0;
+    char *p;
+    unsigned long long start, ovhd, c;
+    double cycles = 0;
+
+    ovhd = counter_overhead();
+    stream = open_trace_stream(tracedir, filename, &header);
+    idmap_init(&live, IDMAP_INIT);
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_stream");
+
+    if (!timed)
+	stats->ops = 0;
+    while ((n = next_trace_window(stream, &ops)) > 0) {
+	for (i = 0; i < n; i++) {
+	    switch (ops[i].type) {
+
+	    case ALLOC: /* mm_malloc */
+		start = read_counter();
+		p = mm_malloc(ops[i].size);
+		c = read_counter() - start;
+		if (p == NULL)
+		    app_error("mm_malloc failed in eval_mm_stream");
+		slot = idmap_insert(&live, ops[i].index);
+		slot->p = p;
+		slot->size = ops[i].size;
+		total_size += ops[i].size;
+		break;
+
+	    case REALLOC: /* mm_realloc */
+		if ((slot = idmap_find(&live, ops[i].index)) == NULL)
+		    app_error("realloc of a dead id in eval_mm_stream");
+		start = read_counter();
+		p = mm_realloc(slot->p, ops[i].size);
+		c = read_counter() - start;
+		if (p == NULL)
+		    app_error("mm_realloc failed in eval_mm_stream");
+		total_size += ops[i].size - slot->size;
+		slot->p = p;
+		slot->size = ops[i].size;
+		break;
+
+	    case FREE: /* mm_free */
+		if ((slot = idmap_find(&live, ops[i].index)) == NULL)
+		    app_error("free of a dead id in eval_mm_stream");
+		start = read_counter();
+		mm_free(slot->p);
+		c = read_counter() - start;
+		total_size -= slot->size;
+		idmap_remove(&live, slot);
+		break;
+
+	    default:
+		app_error("Nonexistent request type in eval_mm_stream");
+		c = 0;
+	    }
+	    cycles += (c > ovhd) ? c - ovhd : 0;
+	    if (total_size > max_total_size)
+		max_total_size = total_size;
+	}
+	if (!timed)
+	    stats->ops += n;
+    }
+    close_trace_stream(stream);
+    free(live.slots);
+
+    if (!timed)
+	stats->util = (double)max_total_size / (double)mem_heapsize();
+    return cycles;
+}
+
+/*
+ * idmap_init - make map an empty map with nslots slots (a power of 2)
+ */
+static void idmap_init(idmap_t *map, unsigned nslots)
+{
+    if ((map->slots = (idslot_t *)malloc(nslots * sizeof(idslot_t))) == NULL)
+	unix_error("malloc failed in idmap_init");
+    memset(map->slots, 0xff, nslots * sizeof(idslot_t)); /* all IDMAP_EMPTY */
+    map->mask = nslots - 1;
+    map->count = 0;
+}
+
+/*
+ * idmap_find - return the slot holding id, or NULL if id isn't live
+ */
+static idslot_t *idmap_find(idmap_t *map, unsigned id)
+{
+    unsigned i = (id * 2654435761u) & map->mask;
+
+    while (map->slots[i].id != id) {
+	if (map->slots[i].id == IDMAP_EMPTY)
+	    return NULL;
+	i = (i + 1) & map->mask;
+    }
+    return &map->slots[i];
+}
+
+/*
+ * idmap_insert - return a slot for id, doubling the map once it is
+ *     half full. id must not be live already.
+ */
+static idslot_t *idmap_insert(idmap_t *map, unsigned id)
+{
+    idmap_t bigger;
+    idslot_t *old;
+    unsigned i;
+
+    if (2 * (map->count + 1) > map->mask + 1) {
+	idmap_init(&bigger, 2 * (map->mask + 1));
+	for (old = map->slots; old <= &map->slots[map->mask]; old++)
+	    if (old->id != IDMAP_EMPTY)
+		*idmap_insert(&bigger, old->id) = *old;
+	free(map->slots);
+	*map = bigger;
+    }
+
+    i = (id * 2654435761u) & map->mask;
+    while (map->slots[i].id != IDMAP_EMPTY)
+	i = (i + 1) & map->mask;
+    map->slots[i].id = id;
+    map->count++;
+    return &map->slots[i];
+}
+
+/*
+ * idmap_remove - empty slot, shifting later entries of its probe run
+ *     back so that lookups never need tombstones
+ */
+static void idmap_remove(idmap_t *map, idslot_t *slot)
+{
+    unsigned hole = slot - map->slots;
+    unsigned i = hole, home;
+
+    for (;;) {
+	i = (i + 1) & map->mask;
+	if (map->slots[i].id == IDMAP_EMPTY)
+	    break;
+	/* Move slot i into the hole unless its home lies in (hole, i] */
+	home = (map->slots[i].id * 2654435761u) & map->mask;
+	if (((i - home) & map->mask) >= ((i - hole) & map->mask)) {
+	    map->slots[hole] = map->slots[i];
+	    hole = i;
+	}
+    }
+    map->slots[hole].id = IDMAP_EMPTY;
+    map->count--;
+}
+
+/*
+ * eval_mm_latency - Replay the trace once, reading the cycle counter
+ *    around every mm_malloc, mm_free and mm_realloc and binning the
+ *    difference, less the cost of reading the counter, in lat. Only the
+ *    two counter reads bracket each call; the bookkeeping is outside.
+ */
+static void eval_mm_latency(trace_t *trace, latency_t *lat)
+{
+    int i, index, type;
+    char *p = NULL;
+    unsigned long long start, end, ovhd, cycles;
+
+    ovhd = counter_overhead();
+    for (type = 0; type < 3; type++)
+	hist_reset(&lat->op[type]);
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_latency");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	type = trace->ops[i].type;
+        switch (type) {
+
+        case ALLOC: /* mm_malloc */
+	    start = read_counter();
+	    p = mm_malloc(trace->ops[i].size);
+	    end = read_counter();
+	    if (p == NULL)
+		app_error("mm_malloc failed in eval_mm_latency");
+	    trace->blocks[index] = p;
+	    break;
+
+	case REALLOC: /* mm_realloc */
+	    start = read_counter();
+	    p = mm_realloc(trace->blocks[index], trace->ops[i].size);
+	    end = read_counter();
+	    if (p == NULL)
+		app_error("mm_realloc failed in eval_mm_latency");
+	    trace->blocks[index] = p;
+	    break;
+
+        case FREE: /* mm_free */
+	    start = read_counter();
+	    mm_free(trace->blocks[index]);
+	    end = read_counter();
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_latency");
+        }
+	cycles = end - start;
+	hist_record(&lat->op[type], (cycles > ovhd) ? cycles - ovhd : 0);
+    }
+}
+
+/*
+ * counter_overhead - cycles between two back-to-back read_counter
+ *    calls, taking the least of many tries to skip interrupts
+ */
+static unsigned long long counter_overhead(void)
+{
+    unsigned long long start, d, best = ~0ULL;
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+	start = read_counter();
+	d = read_counter() - start;
+	if (d < best)
+	    best = d;
+    }
+    return best;
+}
+
+/*
+ * eval_mm_threads - Replay the trace on nthreads threads at once, all
+ *    sharing the one mm heap. A trace with thread ids is split by
+ *    thread id (modulo nthreads), so a block may be freed by another
+ *    thread than the one that allocated it; an untagged trace is split
+ *    by block id. Each op waits until every earlier op on its id is
+ *    done, wherever that ran, so the replay stays legal. mm.c has no
+ *    locking of its own, so each call holds mm_lock; the per-thread
+ *    latencies include the wait for it.
+ */
+static void eval_mm_threads(trace_t *trace, int nthreads, mt_t *mt)
+{
+    mt_replay_t replay;
+    mt_thread_t threads[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    struct timeval *stv, *etv;
+    int i, t;
+
+    replay.trace = trace;
+    replay.nthreads = nthreads;
+    if ((replay.seq = (int *)malloc(trace->num_ops * sizeof(int))) == NULL ||
+	(replay.done = (int *)calloc(trace->num_ids, sizeof(int))) == NULL ||
+	(mt->lat = (hist_t *)malloc(nthreads * sizeof(hist_t))) == NULL)
+	unix_error("malloc failed in eval_mm_threads");
+
+    /* Number the ops on each id; done[] is reused as the counter */
+    for (i = 0; i < trace->num_ops; i++)
+	replay.seq[i] = replay.done[trace->ops[i].index]++;
+    memset(replay.done, 0, trace->num_ids * sizeof(int));
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_threads");
+
+    pthread_barrier_init(&replay.start, NULL, nthreads + 1);
+    for (t = 0; t < nthreads; t++) {
+	threads[t].replay = &replay;
+	threads[t].thread = t;
+	threads[t].lat = &mt->lat[t];
+	hist_reset(threads[t].lat);
+	if (pthread_create(&tids[t], NULL, mt_replay_thread, &threads[t]) != 0)
+	    unix_error("pthread_create failed in eval_mm_threads");
+    }
+    pthread_barrier_wait(&replay.start);
+    for (t = 0; t < nthreads; t++)
+	pthread_join(tids[t], NULL);
+    pthread_barrier_destroy(&replay.start);
+
+    /* Wall time from the first thread starting to the last finishing */
+    stv = &threads[0].start;
+    etv = &threads[0].end;
+    for (t = 1; t < nthreads; t++) {
+	if (timercmp(&threads[t].start, stv, <))
+	    stv = &threads[t].start;
+	if (timercmp(&threads[t].end, etv, >))
+	    etv = &threads[t].end;
+    }
+    mt->secs = (etv->tv_sec - stv->tv_sec) +
+	1E-6*(etv->tv_usec - stv->tv_usec);
+    mt->ops = trace->num_ops;
+    free(replay.seq);
+    free(replay.done);
+}
+
+/*
+ * mt_replay_thread - body of one thread of eval_mm_threads: replay the
+ *    ops of its shard in trace order
+ */
+static void *mt_replay_thread(void *arg)
+{
+    mt_thread_t *self = (mt_thread_t *)arg;
+    mt_replay_t *replay = self->replay;
+    trace_t *trace = replay->trace;
+    int i, index;
+    unsigned shard;
+    char *p = NULL;
+    unsigned long long start;
+
+    pthread_barrier_wait(&replay->start);
+    gettimeofday(&self->start, NULL);
+    for (i = 0; i < trace->num_ops; i++) {
+	index = trace->ops[i].index;
+	shard = (trace->threads != NULL) ? trace->threads[i] : (unsigned)index;
+	if (shard % replay->nthreads != (unsigned)self->thread)
+	    continue;
+
+	/* Wait for the earlier ops on this block, e.g. its malloc */
+	while (__atomic_load_n(&replay->done[index], __ATOMIC_ACQUIRE) !=
+	       replay->seq[i])
+	    sched_yield();
+
+	start = read_counter();
+	pthread_mutex_lock(&mm_lock);
+        switch (trace->ops[i].type) {
+        case ALLOC: /* mm_malloc */
+	    p = mm_malloc(trace->ops[i].size);
+	    break;
+	case REALLOC: /* mm_realloc */
+	    p = mm_realloc(trace->blocks[index], trace->ops[i].size);
+	    break;
+        case FREE: /* mm_free */
+	    mm_free(trace->blocks[index]);
+	    break;
+        }
+	pthread_mutex_unlock(&mm_lock);
+	hist_record(self->lat, read_counter() - start);
+
+	if (trace->ops[i].type != FREE) {
+	    if (p == NULL)
+		app_error("mm_malloc or mm_realloc failed in eval_mm_threads");
+	    trace->blocks[index] = p;
+	}
+	__atomic_store_n(&replay->done[index], replay->seq[i] + 1,
+			 __ATOMIC_RELEASE);
+    }
+    gettimeofday(&self->end, NULL);
+    return NULL;
+}
+
+/*
+ * eval_libc_valid - We run this function to make sure that the
+ *    libc malloc can run to completion on the set of traces.
+ *    We'll be conservative and terminate if any libc malloc call fails.
+ *
+ */
+static int eval_libc_valid(trace_t *trace, int tracenum)
+{
+    int i, newsize;
+    char *p, *newp, *oldp;
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* malloc */
+	    if ((p = malloc(trace->ops[i].size)) == NULL) {
+		malloc_error(tracenum, i, "libc malloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    break;
 
 	case REALLOC: /* realloc */
             newsize = trace->ops[i].size;
@@ -933,7 +2570,7 @@ static void printresults(int n, stats_t *stats)
 	if (stats[i].valid) {
 	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n",
 		   i,
-		   "yes",
+		   stats[i].unchecked ? "unchecked" : "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
 		   stats[i].secs,
@@ -973,6 +2610,74 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+/*
+ * printchase - prints the pointer-chasing results, without and with
+ *     mm_malloc_near
+ */
+static void printchase(int n, chase_t *chase)
+{
+    int i;
+    double cycles[2] = {0, 0};
+
+    printf("%5s%12s%12s%12s%12s\n",
+	   "trace", "gap", "near gap", "cycles", "near cycles");
+    for (i=0; i < n; i++) {
+	printf("%2d%15.0f%12.0f%12.0f%12.0f\n",
+	       i,
+	       chase[i].gap[0],
+	       chase[i].gap[1],
+	       chase[i].cycles[0],
+	       chase[i].cycles[1]);
+	cycles[0] += chase[i].cycles[0];
+	cycles[1] += chase[i].cycles[1];
+    }
+    printf("%-29s%12.0f%12.0f\n", "Total", cycles[0], cycles[1]);
+}
+
+/*
+ * printoracle - prints util without and with oracle lifetime hints
+ */
+static void printoracle(int n, stats_t *stats, double *hint_util)
+{
+    int i;
+    double util = 0, hutil = 0;
+
+    printf("%5s%7s%12s\n", "trace", "util", "hint util");
+    for (i=0; i < n; i++) {
+	printf("%2d%9.0f%%%11.0f%%\n",
+	       i, stats[i].util*100.0, hint_util[i]*100.0);
+	util += stats[i].util;
+	hutil += hint_util[i];
+    }
+    printf("%-5s%6.0f%%%11.0f%%\n", "Total", (util/n)*100.0, (hutil/n)*100.0);
+}
+
+/*
+ * printcompact - prints util for plain blocks, for handles, and for
+ *     handles with mm_compact
+ */
+static void printcompact(int n, stats_t *stats, compact_t *compact)
+{
+    int i;
+    double util = 0, hutil = 0, cutil = 0;
+
+    printf("%5s%7s%12s%12s%8s\n",
+	   "trace", "util", "hdl util", "cmp util", "moved");
+    for (i=0; i < n; i++) {
+	printf("%2d%9.0f%%%11.0f%%%11.0f%%%8d\n",
+	       i,
+	       stats[i].util*100.0,
+	       compact[i].util[0]*100.0,
+	       compact[i].util[1]*100.0,
+	       compact[i].moved);
+	util += stats[i].util;
+	hutil += compact[i].util[0];
+	cutil += compact[i].util[1];
+    }
+    printf("%-5s%6.0f%%%11.0f%%%11.0f%%\n", "Total",
+	   (util/n)*100.0, (hutil/n)*100.0, (cutil/n)*100.0);
+}
+
 /*
  * app_error - Report an arbitrary application error
  */
@@ -1000,19 +2705,412 @@ void malloc_error(int tracenum, int opnum, char *msg)
     printf("ERROR [trace %d, line %d]: %s\n", tracenum, LINENUM(opnum), msg);
 }
 
+/*
+ * printlatency - prints p50/p99/p99.9/max cycles for each request type
+ *     of each trace, then for all the traces together
+ */
+static void printlatency(int n, latency_t *lat)
+{
+    static char *names[3] = {"malloc", "free", "realloc"}; /* by type */
+    latency_t all;
+    hist_t *h;
+    int i, type;
+
+    for (type = 0; type < 3; type++)
+	hist_reset(&all.op[type]);
+
+    printf("%5s %-8s%9s%8s%8s%8s%10s\n",
+	   "trace", "op", "count", "p50", "p99", "p99.9", "max");
+    for (i = 0; i <= n; i++) {
+	for (type = 0; type < 3; type++) {
+	    h = (i < n) ? &lat[i].op[type] : &all.op[type];
+	    if (h->count == 0)
+		continue;
+	    if (i < n) {
+		hist_merge(&all.op[type], h);
+		printf("%2d    ", i);
+	    }
+	    else
+		printf("%-6s", "Total");
+	    printf("%-8s%9llu%8llu%8llu%8llu%10llu\n", names[type], h->count,
+		   hist_percentile(h, 50), hist_percentile(h, 99),
+		   hist_percentile(h, 99.9), h->max);
+	}
+    }
+}
+
+/*
+ * printthreads - prints the threaded replay throughput of each trace,
+ *     followed by the latency percentiles of each of its threads
+ */
+static void printthreads(int n, int nthreads, mt_t *mt)
+{
+    hist_t *h;
+    int i, t;
+    double secs = 0, ops = 0;
+
+    printf("%5s %-7s%8s%10s%6s%8s%8s%8s%10s\n",
+	   "trace", "thread", "ops", "secs", "Kops",
+	   "p50", "p99", "p99.9", "max");
+    for (i = 0; i < n; i++) {
+	if (mt[i].lat == NULL) /* trace wasn't valid */
+	    continue;
+	printf("%2d    %-7s%8.0f%10.6f%6.0f\n", i, "all", mt[i].ops,
+	       mt[i].secs, (mt[i].ops/1e3)/mt[i].secs);
+	for (t = 0; t < nthreads; t++) {
+	    h = &mt[i].lat[t];
+	    printf("%2d    %-7d%8llu%16s%8llu%8llu%8llu%10llu\n", i, t,
+		   h->count, "", hist_percentile(h, 50),
+		   hist_percentile(h, 99), hist_percentile(h, 99.9), h->max);
+	}
+	secs += mt[i].secs;
+	ops += mt[i].ops;
+    }
+    printf("%-13s%8.0f%10.6f%6.0f\n", "Total", ops, secs, (ops/1e3)/secs);
+}
+
+/*
+ * printcounters - prints util and Kops next to IPC and the misses per
+ *     request of each trace, "-" for the counters that are unavailable
+ */
+static void printcounters(int n, stats_t *stats, counters_t *ctrs)
+{
+    static int miss[] = {PC_L1D_MISSES, PC_LLC_MISSES, PC_DTLB_MISSES,
+			 PC_BRANCH_MISSES};
+    double total[PC_NUM], *c, ops, secs, util, totops = 0, totsecs = 0;
+    double totutil = 0;
+    int i, j, valid;
+
+    for (j = 0; j < PC_NUM; j++)
+	total[j] = 0;
+    printf("%5s%7s%6s%6s%8s%8s%8s%8s\n",
+	   "trace", "util", "Kops", "IPC", "L1D/op", "LLC/op", "dTLB/op",
+	   "br/op");
+    for (i = 0; i <= n; i++) {
+	if (i < n) {
+	    if (!stats[i].valid)
+		continue;
+	    c = ctrs[i].count;
+	    ops = stats[i].ops;
+	    secs = stats[i].secs;
+	    util = stats[i].util;
+	    for (j = 0; j < PC_NUM; j++)
+		total[j] = (total[j] < 0 || c[j] < 0) ? -1 : total[j] + c[j];
+	    totops += ops;
+	    totsecs += secs;
+	    totutil += util;
+	    printf("%2d   ", i);
+	}
+	else {
+	    c = total;
+	    ops = totops;
+	    secs = totsecs;
+	    util = totutil / n;
+	    printf("%-5s", "Total");
+	}
+	valid = c[PC_CYCLES] > 0 && c[PC_INSTRUCTIONS] >= 0;
+	printf("%6.0f%%%6.0f", util*100.0, (ops/1e3)/secs);
+	if (valid)
+	    printf("%6.2f", c[PC_INSTRUCTIONS] / c[PC_CYCLES]);
+	else
+	    printf("%6s", "-");
+	for (j = 0; j < sizeof(miss) / sizeof(miss[0]); j++) {
+	    if (c[miss[j]] >= 0 && ops > 0)
+		printf("%8.3f", c[miss[j]] / ops);
+	    else
+		printf("%8s", "-");
+	}
+	printf("\n");
+    }
+}
+
+/*
+ * printtouch - prints throughput without and with touching the payloads
+ */
+static void printtouch(int n, stats_t *stats, double *touch_secs)
+{
+    int i;
+    double secs = 0, tsecs = 0, ops = 0;
+
+    printf("%5s%10s%12s%12s%10s\n", "trace", "Kops", "touch secs",
+	   "touch Kops", "slowdown");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	printf("%2d%13.0f%12.6f%12.0f%9.2fx\n", i,
+	       (stats[i].ops/1e3)/stats[i].secs, touch_secs[i],
+	       (stats[i].ops/1e3)/touch_secs[i], touch_secs[i]/stats[i].secs);
+	secs += stats[i].secs;
+	tsecs += touch_secs[i];
+	ops += stats[i].ops;
+    }
+    printf("%-5s%10.0f%12.6f%12.0f%9.2fx\n", "Total", (ops/1e3)/secs, tsecs,
+	   (ops/1e3)/tsecs, tsecs/secs);
+}
+
+/*
+ * printpolicy - prints the policy mm.c's self-tuning arrived at in the
+ *     last replay, and what it measured in the last epoch
+ */
+static void printpolicy(void)
+{
+    mm_policy_t p;
+
+    mm_policy(&p);
+    printf("policy: best fit below %d free blocks, containers %d; "
+	   "%d changes in %d epochs\n", p.best_fit_threshold,
+	   p.small_blk_size, p.changes, p.epochs);
+    printf("last epoch: %.1f nodes/search (%.1f best fit), fit gain %.3f, "
+	   "%.2f splits/op, %.2f coalesces/free, %.0f%% small\n",
+	   p.search_len, p.best_len, p.fit_gain,
+	   p.split_rate, p.coalesce_rate, p.small_frac * 100);
+}
+
+/*
+ * printextend - prints the heap extensions of each trace, and the heap
+ *     size and unused tail when its live bytes peaked
+ */
+static void printextend(int n, stats_t *stats, extend_t *ext)
+{
+    int i, extends = 0;
+    double heap = 0, tail = 0;
+
+    printf("%5s%9s%10s%10s%7s\n", "trace", "extends", "heap", "tail", "tail%");
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	printf("%2d%12d%10lu%10lu%6.1f%%\n", i, ext[i].extends,
+	       (unsigned long)ext[i].heap, (unsigned long)ext[i].tail,
+	       ext[i].heap ? 100.0 * ext[i].tail / ext[i].heap : 0);
+	extends += ext[i].extends;
+	heap += ext[i].heap;
+	tail += ext[i].tail;
+    }
+    printf("%-5s%9d%10.0f%10.0f%6.1f%%\n", "Total", extends, heap, tail,
+	   heap ? 100.0 * tail / heap : 0);
+}
+
+/*
+ * printmmstats - prints what mm_stats reports at the end of the last replay
+ */
+static void printmmstats(void)
+{
+    mm_stats_t s;
+
+    mm_stats(&s);
+    printf("mm_stats: heap %lu, live %lu, free %lu in %lu blocks; "
+	   "%llu extends, %llu splits, %llu coalesces\n",
+	   (unsigned long)s.heap_bytes, (unsigned long)s.live_bytes,
+	   (unsigned long)s.free_bytes, (unsigned long)s.free_blocks,
+	   s.extends, s.splits, s.coalesces);
+}
+
+/*
+ * printinstr - prints, for each trace, how mm_malloc's requests were
+ *     served, the coalesce cases and mm_realloc paths, and histograms of
+ *     the free list nodes find_fit visited and of the bytes place split off
+ */
+static void printinstr(int n, char **tracefiles, stats_t *stats,
+		       mm_instr_t *instr)
+{
+    int i;
+    mm_instr_t *s;
+
+    for (i = 0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	s = &instr[i];
+	printf("%2d %s\n", i, tracefiles[i]);
+	printf("   malloc:   small %llu, first fit %llu hit / %llu miss, "
+	       "best fit %llu hit / %llu miss\n", s->small,
+	       s->fit[0][1], s->fit[0][0], s->fit[1][1], s->fit[1][0]);
+	printf("   coalesce: neither %llu, next %llu, prev %llu, both %llu\n",
+	       s->coalesce[0], s->coalesce[1], s->coalesce[2], s->coalesce[3]);
+	printf("   realloc:  shrink %llu, grow next %llu, grow prev %llu, "
+	       "same %llu, copy %llu\n", s->realloc[MM_REALLOC_SHRINK],
+	       s->realloc[MM_REALLOC_NEXT], s->realloc[MM_REALLOC_PREV],
+	       s->realloc[MM_REALLOC_SAME], s->realloc[MM_REALLOC_COPY]);
+	printf("   place:    %llu used the whole block\n", s->whole);
+	printloghist("find_fit nodes visited", s->visited);
+	printloghist("place bytes split off", s->split);
+    }
+}
+
+/*
+ * printloghist - prints one mm_instr_t histogram, from its first to its
+ *     last non-empty bucket, with a bar scaled to the largest bucket
+ */
+static void printloghist(char *title, unsigned long long *buckets)
+{
+    int b, lo, hi, len;
+    unsigned long long total = 0, max = 0;
+    char range[2*20 + 2]; /* two 20-digit numbers, a dash and the NUL */
+
+    for (lo = -1, hi = 0, b = 0; b < MM_INSTR_BUCKETS; b++) {
+	total += buckets[b];
+	if (buckets[b] > max)
+	    max = buckets[b];
+	if (buckets[b] > 0) {
+	    if (lo < 0)
+		lo = b;
+	    hi = b;
+	}
+    }
+    printf("   %s (%llu):\n", title, total);
+    if (total == 0)
+	return;
+    for (b = lo; b <= hi; b++) {
+	if (b == 0)
+	    snprintf(range, sizeof(range), "0");
+	else if (b == MM_INSTR_BUCKETS - 1)
+	    snprintf(range, sizeof(range), "%llu+", 1ULL << (b - 1));
+	else if (b == 1)
+	    snprintf(range, sizeof(range), "1");
+	else
+	    snprintf(range, sizeof(range), "%llu-%llu", 1ULL << (b - 1),
+		     (1ULL << b) - 1);
+	len = (int)((HIST_BAR * buckets[b] + max - 1) / max);
+	printf("%16s %9llu %5.1f%% %.*s\n", range, buckets[b],
+	       100.0 * buckets[b] / total, len, INSTR_BAR);
+    }
+}
+
+/*
+ * printnull - prints the time of each trace with and without the driver
+ *     overhead measured by eval_null_speed, and Kops for both
+ */
+static void printnull(int n, stats_t *stats, double *null_secs)
+{
+    int i;
+    double secs, base, ops, alloc;
+    double tot_secs = 0, tot_base = 0, tot_ops = 0;
+
+    printf("%5s%10s%10s%10s%9s%8s%6s\n", "trace", "raw secs", "driver",
+	   "alloc", "raw Kops", "Kops", "ovhd");
+    for (i = 0; i <= n; i++) {
+	if (i < n) {
+	    if (!stats[i].valid)
+		continue;
+	    secs = stats[i].secs;
+	    base = null_secs[i];
+	    ops = stats[i].ops;
+	    tot_secs += secs;
+	    tot_base += base;
+	    tot_ops += ops;
+	    printf("%2d   ", i);
+	}
+	else {
+	    secs = tot_secs;
+	    base = tot_base;
+	    ops = tot_ops;
+	    printf("%-5s", "Total");
+	}
+	alloc = secs - base;
+	printf("%10.6f%10.6f", secs, base);
+	if (alloc > 0)
+	    printf("%10.6f%9.0f%8.0f%5.0f%%\n", alloc, (ops/1e3)/secs,
+		   (ops/1e3)/alloc, (base/secs)*100);
+	else /* the allocator is lost in the noise of the baseline */
+	    printf("%10s%9.0f%8s%6s\n", "-", (ops/1e3)/secs, "-", "-");
+    }
+}
+
+/*
+ * printbench - prints the median, MAD and confidence interval of the
+ *     throughput of each trace's benchmark runs
+ */
+static void printbench(int n, bench_t *bench)
+{
+    int i;
+    double med, lo, hi;
+
+    printf("%5s%6s%10s%8s%10s%10s%8s\n",
+	   "trace", "runs", "Kops", "MAD", "CI lo", "CI hi", "+/-");
+    for (i = 0; i < n; i++) {
+	if (bench[i].runs == 0) /* trace wasn't valid */
+	    continue;
+	med = bench_median(bench[i].kops, bench[i].runs);
+	bench_ci(bench[i].kops, bench[i].runs, BENCH_CONF, &lo, &hi);
+	printf("%2d%9d%10.0f%8.0f%10.0f%10.0f%7.1f%%\n", i, bench[i].runs,
+	       med, bench_mad(bench[i].kops, bench[i].runs), lo, hi,
+	       (hi - lo) / 2 / med * 100);
+    }
+}
+
+/*
+ * writebench - writes the per-run throughput of each trace for
+ *     mmcompare: a comment line, then the trace name and its samples
+ */
+static void writebench(char *path, int n, char **tracefiles, bench_t *bench)
+{
+    FILE *fp;
+    int i, j;
+
+    if ((fp = fopen(path, "w")) == NULL)
+	unix_error(path);
+    fprintf(fp, "# mdriver -B: Kops of each run\n");
+    for (i = 0; i < n; i++) {
+	if (bench[i].runs == 0)
+	    continue;
+	fprintf(fp, "%s", tracefiles[i]);
+	for (j = 0; j < bench[i].runs; j++)
+	    fprintf(fp, " %.3f", bench[i].kops[j]);
+	fprintf(fp, "\n");
+    }
+    if (fclose(fp) != 0)
+	unix_error(path);
+}
+
+/*
+ * pin_cpu - run the driver on one CPU only, where the OS supports it
+ */
+static void pin_cpu(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0)
+	unix_error("sched_setaffinity failed");
+#else
+    fprintf(stderr, "Warning: -C is not supported here; not pinning\n");
+#endif
+}
+
 /*
  * usage - Explain the command line arguments
  */
 static void usage(void)
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvVaAEIlcokjNpPSx] [-f <file>] [-F <n>] [-t <dir>] [-T <n>]\n"
+	    "               [-B <runs> [-w <file>]] [-C <cpu>] [-s <n|grid> [-O <file>]]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
-    fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-A         Also time a replay that writes and reads the blocks.\n");
+    fprintf(stderr, "\t-B <runs>  Time each trace <runs> times; print median and CI.\n");
+    fprintf(stderr, "\t-c         Measure pointer chasing with mm_malloc_near.\n");
+    fprintf(stderr, "\t-C <cpu>   Run on CPU <cpu> only.\n");
+    fprintf(stderr, "\t-E         Count heap extensions and the unused heap tail.\n");
+    fprintf(stderr, "\t-f <file>  Use <file> (.rep or binary) as the trace file.\n");
+    fprintf(stderr, "\t-F <n>     Write heap fragmentation every <n> ops to <trace>.frag.csv.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-I         Print mm.c's placement histograms (MM_INSTRUMENT).\n");
+    fprintf(stderr, "\t-j         Write the -F samples as JSON instead.\n");
+    fprintf(stderr, "\t-k         Measure util of handles with mm_compact.\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-N         Also report time without the driver's overhead.\n");
+    fprintf(stderr, "\t-o         Measure util with oracle lifetime hints.\n");
+    fprintf(stderr, "\t-O <file>  Write the -s Pareto front to <file> (default %s).\n", SWEEP_FILE);
+    fprintf(stderr, "\t-p         Print per-op latency percentiles (cycles).\n");
+    fprintf(stderr, "\t-P         Print hardware counters (IPC, misses/op).\n");
+    fprintf(stderr, "\t-s <n>     Sweep the mm.c tunables: <n> random configs, or \"grid\".\n");
+    fprintf(stderr, "\t-S         Stream traces through mm (payloads unchecked, no perf index).\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T <n>     Also replay each trace on <n> threads at once.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
+    fprintf(stderr, "\t-w <file>  Write the -B samples to <file>, for mmcompare.\n");
+    fprintf(stderr, "\t-x         Keep the mm.c tunables fixed (no self-tuning).\n");
 }
@@ -0,0 +1,139 @@
+/*
+ * memlib_mmap.c - memlib.h over real memory, for running programs on
+ *     mm.c (see mmshim.c) rather than replaying traces in mdriver
+ *
+ * mem_init reserves MMSHIM_HEAP_MB megabytes (default 1024) of address
+ * space with no access, and mem_sbrk makes pages readable and writable
+ * as the brk moves up, so the heap costs only the memory mm.c touches.
+ * mm.c keeps pointers in 32-bit heap words, so on 64-bit hosts the
+ * reservation is placed below 4GB. Nothing here allocates from the C
+ * library heap, which the shim replaces.
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <errno.h>
+
+#include "memlib.h"
+
+#define DEFAULT_HEAP_MB 1024
+#define LOW_HINT ((void *)0x40000000) /* where to ask for the heap */
+
+/* private variables */
+static char *mem_start_brk;  /* points to first byte of heap */
+static char *mem_brk;        /* points to last byte of heap */
+static char *mem_max_addr;   /* largest legal heap address */
+static char *mem_mapped;     /* end of the pages made accessible so far */
+
+/* mem_error - report a failure without calling into stdio's malloc */
+static void mem_error(char *msg)
+{
+    if (write(2, msg, strlen(msg)) < 0)
+	return;
+}
+
+/*
+ * mem_init - reserve the address space for the heap. If that fails the
+ *     heap is left empty and every mem_sbrk fails.
+ */
+void mem_init(void)
+{
+    char *env = getenv("MMSHIM_HEAP_MB");
+    size_t size = (env != NULL && atoi(env) > 0) ? atoi(env) : DEFAULT_HEAP_MB;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    char *p;
+
+    size <<= 20;
+#if defined(MAP_32BIT)
+    if (sizeof(void *) > 4)
+	flags |= MAP_32BIT;
+#endif
+    p = mmap(LOW_HINT, size, PROT_NONE, flags, -1, 0);
+    if (p == MAP_FAILED ||
+	(sizeof(void *) > 4 && (unsigned long)(p + size) > 0xffffffffUL)) {
+	if (p != MAP_FAILED)
+	    munmap(p, size);
+	mem_error("mem_init: could not reserve a heap below 4GB\n");
+	mem_start_brk = mem_brk = mem_max_addr = mem_mapped = NULL;
+	return;
+    }
+    mem_start_brk = mem_brk = mem_mapped = p;
+    mem_max_addr = p + size;
+}
+
+/*
+ * mem_deinit - give the heap back to the system
+ */
+void mem_deinit(void)
+{
+    if (mem_start_brk != NULL)
+	munmap(mem_start_brk, mem_max_addr - mem_start_brk);
+    mem_start_brk = mem_brk = mem_max_addr = mem_mapped = NULL;
+}
+
+/*
+ * mem_reset_brk - reset the brk pointer to make an empty heap. The
+ *     pages stay mapped.
+ */
+void mem_reset_brk()
+{
+    mem_brk = mem_start_brk;
+}
+
+/*
+ * mem_sbrk - extend the heap by incr bytes and return the start address
+ *     of the new area, making whole pages accessible as needed. The heap
+ *     cannot be shrunk.
+ */
+void *mem_sbrk(int incr)
+{
+    char *old_brk = mem_brk;
+    char *end;
+    size_t page = getpagesize();
+
+    errno = ENOMEM;
+    if (incr < 0 || mem_brk == NULL || incr > mem_max_addr - mem_brk)
+	return (void *)-1;
+    if (mem_brk + incr > mem_mapped) {
+	end = mem_start_brk +
+	    ((mem_brk + incr - mem_start_brk + page - 1) & ~(page - 1));
+	if (mprotect(mem_mapped, end - mem_mapped, PROT_READ | PROT_WRITE) < 0)
+	    return (void *)-1;
+	mem_mapped = end;
+    }
+    mem_brk += incr;
+    return (void *)old_brk;
+}
+
+/*
+ * mem_heap_lo - return address of the first heap byte
+ */
+void *mem_heap_lo()
+{
+    return (void *)mem_start_brk;
+}
+
+/*
+ * mem_heap_hi - return address of last heap byte
+ */
+void *mem_heap_hi()
+{
+    return (void *)(mem_brk - 1);
+}
+
+/*
+ * mem_heapsize() - returns the heap size in bytes
+ */
+size_t mem_heapsize()
+{
+    return (size_t)(mem_brk - mem_start_brk);
+}
+
+/*
+ * mem_pagesize() - returns the page size of the system
+ */
+size_t mem_pagesize()
+{
+    return (size_t)getpagesize();
+}
@@ -16,9 +16,13 @@ This is our memory allocator.  It contains the following features:
 uses a best fit search of the free list to place an allocated block
 -otherwise, it uses first fit
 -the free block found is deleted from the free list
-•Dynamic Chunk Sizing (size of heap extension)
+•Predicted Heap Extension
 -This is another feature we added for both throughput and space efficiency
--The chunk size will gravitate towards the average request size
+-When no free block fits, the heap grows by the request plus what the next
+EXTEND_AHEAD requests are likely to miss by, predicted from a decayed
+histogram of the sizes of recent misses
+-A free block at the end of the heap counts toward the extension, since it
+merges with it
 -This helps with external fragmentation (prevents allocating excessively large chunks)
 •Grouping Small blocks
 -We reserve special places in the heap for small blocks only
@@ -27,6 +31,36 @@ and being unusable after freeing
 -When grouped, small blocks with coalesce into a larger one and it is more
 likely that the block can be re-used
 •Immediate Coalescing is used to combine free blocks and reduce external fragmentation
+•Lifetime hints
+-mm_malloc_hint keeps short-lived blocks in zones of their own so they
+don't break up free space around long-lived blocks
+•Relocatable blocks
+-mm_halloc returns a handle instead of a pointer; mm_compact may slide
+unlocked handle blocks together to merge free space
+•Locality hints
+-mm_malloc_near places a block close to a related block when a free block
+within a page of it fits
+•Tunables
+-the sizes and thresholds that steer the policies above can be changed at
+run time with mm_set_tunable, for the driver's parameter sweep (mdriver -s)
+•Statistics
+-mm_stats fills in the heap size, live and free bytes, free list length and
+running counts of heap extensions, splits and coalesces; mm_stats_dump
+writes them as text or JSON for a monitoring agent. The counts are plain
+increments on paths that already run, so they are always on
+•Instrumentation
+-compiled with MM_INSTRUMENT defined (make MM_INSTRUMENT=1), mm.c also
+records how find_fit, place, coalesce and mm_realloc go: nodes visited per
+search, hits and misses of each fit policy, split remainders, coalesce cases
+and realloc paths. mm_instr returns them; without MM_INSTRUMENT the INSTR
+statements compile to nothing
+•Self-tuning
+-every EPOCH_MALLOCS requests, the best fit threshold and the small block
+container size are adjusted from what the last epoch saw: how far find_fit
+searched, how much space best fit saved over first fit, and how many
+requests were small. A change needs HYSTERESIS epochs in a row that agree,
+so the policy doesn't flap. mm_policy reports the state; mm_set_adaptive(0)
+keeps the tunables fixed instead
 */
 
 #include <stdio.h>
@@ -34,6 +68,7 @@ likely that the block can be re-used
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "mm.h"
 #include "memlib.h"
@@ -63,13 +98,42 @@ team_t team = {
 /* rounds up to the nearest multiple of ALIGNMENT */
 #define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~0x7)
 #define MIN_BLOCK_SIZE 16
-#define ONLY_SMALL_BLK_SIZE 1500 //size of reserved block for small blocks only
-#define BEST_FIT_THRESHOLD 25 //threshold size of free list for choosing first fit instead of best fit
-#define MIN_CHUNK (1<<9)//min chunk size for extending heap
-#define MAX_CHUNK (1<<30)//max chunk size for extending heap
-#define DEFAULT_CHUNK (1<<11)//default chunk size for extending heap
-#define CHUNK_UPDATE_AMT 1024 //how much to change CHUNK_SIZE at a time
+#define ONLY_SMALL_BLK_SIZE (policy.small_blk_size) //size of reserved block for small blocks only
+#define BEST_FIT_THRESHOLD (policy.best_fit_threshold) //threshold size of free list for choosing first fit instead of best fit
+#define MIN_CHUNK (tunables[MM_MIN_CHUNK].value)//min chunk size for extending heap
+#define MAX_CHUNK (tunables[MM_MAX_CHUNK].value)//max chunk size for extending heap
+#define DEFAULT_CHUNK (1<<11)//size of the heap's first extension
+#define EXTEND_AHEAD (tunables[MM_EXTEND_AHEAD].value) //requests a heap extension should cover after this one
+#define MISS_CLASSES 32 //miss size histogram buckets, one per power of two
+#define MISS_WINDOW 64 //the miss histogram decays by 1/MISS_WINDOW per request
+#define MISS_LIKELY 0.5 //size classes expected to miss fewer times than this in EXTEND_AHEAD requests are ignored
+#define NEAR_RANGE 4096 //how far from the hint mm_malloc_near will look (one page)
+#define NEAR_SCAN_LIMIT 64 //max free list nodes mm_malloc_near looks at
+#define SMALL_SIZE (tunables[MM_SMALL_SIZE].value) //requests below this block size go in the small block container
+#define SHORT_ZONE_SIZE (1<<12) //size of a zone for short-lived blocks
+#define SHORT_MAX_SIZE (SHORT_ZONE_SIZE/8) //larger short-lived requests use the main heap
+#define MAX_ZONES 32 //max number of short-lived zones at once
+#define ZONE_OVERHEAD (3*DSIZE) //pad, prologue and epilogue words inside a zone
+#define HANDLE_TABLE_INIT 64 //initial number of handle table entries
+#define COMPACT_CHECK 16 //blocks mm_compact visits between checks of its time budget
+#define EPOCH_MALLOCS 256 //requests between self-tuning decisions
+#define HYSTERESIS 2 //epochs in a row that must agree before the policy changes
+#define PROBE_EVERY 16 //in first fit, one search in this many is a best fit, to measure it
+#define PROBE_RARELY 1024 //probes back off to this while they find best fit doesn't pay
+#define PROBE_MAX_LIST (4*SEARCH_BUDGET) //no probes of free lists longer than this
+#define FIT_GAIN_HIGH 0.05 //best fit saving more than this fraction of the bytes requested pays
+#define FIT_GAIN_LOW 0.01 //best fit saving less than this doesn't
+#define SEARCH_BUDGET 32 //free list nodes a best fit search may visit, on average
+#define MAX_BEST_FIT (1<<12) //highest the self-tuning raises the best fit threshold
+#define SMALL_HIGH 0.5 //more requests than this are small: bigger containers
+#define SMALL_LOW 0.01 //fewer than this are small: smaller containers
 #define MAX(x,y) ((x) > (y)? (x) : (y))//max of two things
+#define MIN(x,y) ((x) < (y)? (x) : (y))//min of two things
+#ifdef MM_INSTRUMENT
+#define INSTR(stmt) stmt//instrumentation statement, only with MM_INSTRUMENT
+#else
+#define INSTR(stmt)
+#endif
 #define PACK(size,alloc) ((size) | (alloc))//used for making headers and footers
 #define GET(p) (*(unsigned int *)(p))//gets p because b is a void *
 #define PUT(p,val) (*(unsigned int *)(p) = (val))//puts val into p pointer
@@ -82,10 +146,74 @@ team_t team = {
 #define PREV(bp) ((char *) (bp))//prev pointer for free list location
 #define NEXT(bp) ((char *) (bp)+WSIZE)//next pointer for free list location
 
-static int CHUNK_SIZE = DEFAULT_CHUNK;//Chunks size variable
+/* a policy tunable: its current value and the values mm_set_tunable accepts.
+The ranges keep every combination consistent: the small block container
+always has room for a small block plus a minimum size free block */
+typedef struct {
+    const char * name;
+    int value;
+    int min;
+    int max;
+} tunable;
+
+static tunable tunables[MM_NUM_TUNABLES] = {
+    {"small_blk_size", 1500, 528, 1<<16},     //MM_SMALL_BLK_SIZE
+    {"best_fit_threshold", 25, 0, 1<<20},     //MM_BEST_FIT_THRESHOLD
+    {"small_size", 100, 0, 512},              //MM_SMALL_SIZE
+    {"extend_ahead", 8, 0, 1024},             //MM_EXTEND_AHEAD
+    {"min_chunk", 1<<9, 64, 1<<20},           //MM_MIN_CHUNK
+    {"max_chunk", 1<<30, 1<<12, 1<<30},       //MM_MAX_CHUNK
+};
+
+/* what the self-tuning counts during an epoch */
+typedef struct {
+    int mallocs;//requests
+    int small;//requests below SMALL_SIZE
+    int searches;//find_fit calls that found a block
+    int measured;//of those, searches that were best fit
+    unsigned long long visited;//free list nodes find_fit looked at
+    unsigned long long best_visited;//of those, nodes best fit searches looked at
+    unsigned long long requested;//bytes asked of best fit searches
+    unsigned long long saved;//bytes those found closer than first fit would have
+    int splits;//blocks split by place
+    int frees;//blocks freed
+    int coalesces;//frees that merged with a neighbour
+} epoch_stats;
+
+static mm_policy_t policy;//the policy in force, reset from the tunables by mm_init
+static epoch_stats epoch;//counts for the current epoch
+static int adaptive = 1;//adjust the policy every epoch?
+static int probe_every = PROBE_EVERY;//first fit searches between probes
+static int probe_countdown = PROBE_EVERY;//first fit searches until the next best fit
+static int fit_votes = 0;//epochs in a row for raising (>0) or lowering (<0) the threshold
+static int small_votes = 0;//same, for the container size
+
+static double miss_count[MISS_CLASSES];//decayed number of recent misses in each size class
+static double miss_bytes[MISS_CLASSES];//decayed bytes they asked for
+static unsigned int requests = 0;//mm_malloc calls since mm_init
+static unsigned int miss_decayed = 0;//value of requests when the histogram was last decayed
+static mm_stats_t counts;//running counts for mm_stats, reset by mm_init
+#ifdef MM_INSTRUMENT
+static mm_instr_t instr;//what the instrumentation recorded since mm_init
+#endif
 static void * free_list_head=NULL;//head of free list
 static void * only_small_blk=NULL;//location of block reserved from small blocks
-static unsigned long long free_list_size=0;//keeps track of the free list size
+static unsigned long long free_list_size=0;//keeps track of the free list size (both lists)
+static void * short_list_head=NULL;//head of free list for blocks inside short-lived zones
+static void * zones[MAX_ZONES];//short-lived zones, each an allocated block holding a small heap
+static int num_zones=0;//number of entries in zones
+
+/* handle table entry. The first payload word of a handle block holds its
+handle, so the two always point at each other */
+typedef struct {
+    char * bp;//block holding the object, NULL if the entry is free
+    int locks;//lock count, or the next free entry if bp is NULL
+} handle_entry;
+
+static handle_entry * handles=NULL;//handle table, itself a block on the heap
+static int num_handles=0;//entries in the handle table (entry 0 is never used)
+static int free_handle=0;//first free entry in the handle table (0 = none)
+static int compact_cursor=0;//handle where mm_compact stopped (0 = start of heap)
 static char * heap_listp=NULL;//start of heap
 
 static void * extend_heap(size_t words);
@@ -94,12 +222,25 @@ static void * find_fit(size_t asize);
 static void place(void* bp, size_t asize);
 static void del_free_list_node(void* bp);
 static void ins_free_list_node(void *bp);
-static void copy(const int* b1,const int* b2);
 static void createFreeBlock(void * bp,size_t asize);
 static void reserveOnlySmallBlock();
 static void createAllocBlock(void * bp,size_t asize);
 static void createAllocBlockWithData(void * bp,size_t size, void * data);
 static void place_into_allocated_block(void* bp, size_t asize);
+static size_t adjust_size(size_t size);
+static void * create_zone(void);
+static int in_zone(void * bp);
+static void release_zone(void * bp);
+static int grow_handles(void);
+static int is_handle_block(void * bp);
+static void * slide_block(void * fp, void * bp);
+static size_t extend_size(size_t asize);
+static void note_request(size_t asize);
+static void adapt(void);
+static int agreed(int * votes, int vote);
+#ifdef MM_INSTRUMENT
+static int log2_bucket(unsigned long long v);
+#endif
 int mm_check();
 
 /*   mm_init
@@ -110,18 +251,35 @@ allocates space for only small blocks.
 int mm_init(void)
 {
     free_list_head=NULL;
+    short_list_head=NULL;
+    num_zones=0;
+    handles=NULL;
+    num_handles=0;
+    free_handle=0;
+    compact_cursor=0;
     heap_listp=NULL;
     if((heap_listp = mem_sbrk(4*WSIZE)) == (void *) -1){
         return -1;
     }
-    CHUNK_SIZE =DEFAULT_CHUNK;
+    memset(&counts,0,sizeof(counts));
+    INSTR(memset(&instr,0,sizeof(instr)));
+    memset(miss_count,0,sizeof(miss_count));
+    memset(miss_bytes,0,sizeof(miss_bytes));
+    requests = miss_decayed = 0;
+    memset(&policy,0,sizeof(policy));
+    policy.best_fit_threshold = tunables[MM_BEST_FIT_THRESHOLD].value;
+    policy.small_blk_size = tunables[MM_SMALL_BLK_SIZE].value;
+    memset(&epoch,0,sizeof(epoch));
+    probe_every = PROBE_EVERY;
+    probe_countdown = PROBE_EVERY;
+    fit_votes = small_votes = 0;
     PUT(heap_listp,0);
     free_list_size=0;
     PUT(heap_listp + (1*WSIZE), PACK(DSIZE,1));//prolouge block header
     PUT(heap_listp + (2*WSIZE), PACK(DSIZE,1));//prolouge block footer
     PUT(heap_listp + (3*WSIZE), PACK(0,1));//epilogue block (size 0, allocated)
     heap_listp += (2*WSIZE);
-    if((extend_heap(CHUNK_SIZE/WSIZE)) == NULL){
+    if((extend_heap(DEFAULT_CHUNK/WSIZE)) == NULL){
         return -1;
     }
     reserveOnlySmallBlock();
@@ -135,10 +293,7 @@ int mm_init(void)
 uses a best fit search of the free list to place an allocated block
 -otherwise, it uses first fit
 -the free block found is deleted from the free list
-•Dynamic Chunk Sizing (size of heap extension)
--This is another feature we added for both throughput and space efficiency
--The chunk size will gravitate towards the average request size
--This helps with external fragmentation (prevents allocating excessively large chunks)
+•Predicted Heap Extension (see extend_size)
 •Grouping Small blocks
 -We reserve special places in the heap for small blocks only
 -This prevents small splinters from forming in between larger blocks
@@ -162,13 +317,15 @@ void *mm_malloc(size_t size)
         return NULL;
     }
 
-    asize = ALIGN(size) + 8;//alignes to double word
-    if(asize < MIN_BLOCK_SIZE){
-        asize = MIN_BLOCK_SIZE; //Maintain minimum block size
+    asize = adjust_size(size);
+    ++requests;
+    if(adaptive){
+        note_request(asize);
     }
 
-    if(asize < 100){//special spot for small items
+    if(asize < SMALL_SIZE){//special spot for small items
         int csize = GET_SIZE(HDRP(only_small_blk));
+        INSTR(++instr.small);
         if(asize < csize && (csize - asize) >= MIN_BLOCK_SIZE){
             void * ret_val = only_small_blk;
             PUT(HDRP(only_small_blk),PACK(asize,1));
@@ -203,26 +360,96 @@ void *mm_malloc(size_t size)
 
     //if here, find fit failed to find a usable free block
     //need to extend the heap
-    extendsize = MAX(asize,CHUNK_SIZE);
-    if(asize<(CHUNK_SIZE+CHUNK_UPDATE_AMT)){//dynamic updating of chunk size
-        CHUNK_SIZE+=CHUNK_UPDATE_AMT;
-    }else if ((asize-CHUNK_UPDATE_AMT) > CHUNK_SIZE){
-        CHUNK_SIZE-=CHUNK_UPDATE_AMT;
+    extendsize = extend_size(asize);
+    if((bp=extend_heap(extendsize/WSIZE)) == NULL){
+        return NULL;
     }
 
-    if(CHUNK_SIZE > MAX_CHUNK){
-        CHUNK_SIZE=MAX_CHUNK;
-    }else if(CHUNK_SIZE < MIN_CHUNK){
-        CHUNK_SIZE=MIN_CHUNK;
+    place(bp,asize);
+    return bp;
+
+}
+
+/* mm_malloc_near
+•same as mm_malloc, but tries to place the block within NEAR_RANGE bytes of
+near, so objects that are traversed together share pages and cache lines
+•small requests always go to the small block container, as in mm_malloc
+•otherwise the first NEAR_SCAN_LIMIT nodes of the free list are searched for
+the closest block that fits; if none is in range, falls back to mm_malloc
+•near must be an allocated block, or NULL (same as calling mm_malloc)
+*/
+void *mm_malloc_near(void *near, size_t size)
+{
+    size_t asize;
+    size_t dist;
+    size_t best_dist = NEAR_RANGE + 1;
+    void * best = NULL;
+    void * bp;
+    int scanned = 0;
+
+    if(near==NULL || size==0){
+        return mm_malloc(size);
     }
 
-    if((bp=extend_heap(extendsize/WSIZE)) == NULL){
-        return NULL;
+    asize = adjust_size(size);
+    if(asize < SMALL_SIZE){//keep small blocks in their container
+        return mm_malloc(size);
+    }
+
+    for(bp=free_list_head; bp!=NULL && scanned < NEAR_SCAN_LIMIT; bp = (void*)GET(NEXT(bp))){
+        ++scanned;
+        if(asize > GET_SIZE(HDRP(bp))){
+            continue;
+        }
+        dist = (char *)bp > (char *)near ? (char *)bp - (char *)near : (char *)near - (char *)bp;
+        if(dist < best_dist){
+            best_dist = dist;
+            best = bp;
+            if(bp == NEXT_BLKP(near)){//can't get any closer than the next block
+                break;
+            }
+        }
+    }
+
+    if(best==NULL){
+        return mm_malloc(size);
+    }
+    place(best,asize);
+    return best;
+}
+
+/* mm_malloc_hint
+•same as mm_malloc, but hint says how long the block is expected to live
+•MM_SHORT_LIVED blocks are placed in zones: allocated blocks of the main heap
+that hold their own prologue, epilogue and free list (short_list_head). Short
+lived blocks only coalesce with each other, so they never pin long lived
+neighbours, and a zone that empties out is given back to the main heap
+•MM_LONG_LIVED (or no hint) uses the main heap, exactly like mm_malloc, and
+so do short-lived requests over SHORT_MAX_SIZE, so a few big blocks can't
+fill up a zone
+•falls back to the main heap if MAX_ZONES zones are already in use
+*/
+void *mm_malloc_hint(size_t size, int hint)
+{
+    size_t asize;
+    void * bp;
+
+    if((hint & (MM_SHORT_LIVED|MM_LONG_LIVED)) != MM_SHORT_LIVED || size==0 || size > SHORT_MAX_SIZE){
+        return mm_malloc(size);
+    }
+
+    asize = adjust_size(size);
+    for(bp=short_list_head; bp!=NULL; bp = (void*)GET(NEXT(bp))){//first fit
+        if(asize <= GET_SIZE(HDRP(bp))){
+            break;
+        }
+    }
+    if(bp==NULL && (num_zones==MAX_ZONES || (bp=create_zone()) == NULL)){
+        return mm_malloc(size);
     }
 
     place(bp,asize);
     return bp;
-
 }
 
 /* mm_free
@@ -238,11 +465,52 @@ void mm_free(void *ptr)
 
     size_t size = GET_SIZE(HDRP(ptr));
 
+    ++epoch.frees;
     createFreeBlock(ptr,size);
-    coalesce(ptr);
+    ptr = coalesce(ptr);
+    if(num_zones > 1){
+        release_zone(ptr);
+    }
 
 }
 
+/* mm_free_sized
+•same as mm_free, but the caller passes the size it last requested for ptr
+(or the value returned by mm_usable_size)
+•the block size still comes from the header: a block left padded when placed
+has payload where a block of exactly that size would keep its footer, so the
+size passed in can't tell where the block ends
+•Compile with -DDEBUG to check size against the header
+*/
+void mm_free_sized(void *ptr, size_t size)
+{
+#ifdef DEBUG
+    size_t asize = adjust_size(size);
+    size_t hsize = GET_SIZE(HDRP(ptr));
+    if(asize > hsize || (hsize - asize) >= MIN_BLOCK_SIZE){
+        printf("mm_free_sized: size %u does not match block %p of size %u\n",
+               (unsigned int)size, ptr, (unsigned int)hsize);
+        exit(1);
+    }
+#endif
+
+    mm_free(ptr);
+}
+
+/* mm_usable_size
+•returns the number of payload bytes in the block pointed to by ptr
+•this is at least the size last requested for ptr, and includes the slack left
+by rounding the request up to a double word (and any unsplit remainder)
+•returns 0 if ptr is NULL
+*/
+size_t mm_usable_size(void *ptr)
+{
+    if(ptr==NULL){
+        return 0;
+    }
+    return GET_SIZE(HDRP(ptr)) - DSIZE;
+}
+
 /*  mm_realloc
 •realloactes the block ptr to be the new size
 •if ptr = null, equivalent to mm_malloc(size)
@@ -269,17 +537,13 @@ void *mm_realloc(void *ptr, size_t size)
         return NULL;
     }
 
-    size_t asize;
-    if(size < MIN_BLOCK_SIZE){
-        asize = MIN_BLOCK_SIZE;
-    }else{
-        asize = ALIGN(size) + 8;
-    }
+    size_t asize = adjust_size(size);
 
     size_t cur_size = GET_SIZE(HDRP(ptr));
 
 
     if(asize < cur_size){ //The block size is being decreased
+        INSTR(++instr.realloc[MM_REALLOC_SHRINK]);
         place_into_allocated_block(ptr,asize);
         return ptr;
     }
@@ -294,12 +558,14 @@ void *mm_realloc(void *ptr, size_t size)
                 PUT(FTRP(ptr),PACK(asize,1));
                 void * freeptr= NEXT_BLKP(ptr);
                 createFreeBlock(freeptr,next_blk_size-extra_space);
+                INSTR(++instr.realloc[MM_REALLOC_NEXT]);
                 return ptr;
             }
             else if(next_blk_size == (asize - cur_size)){//block is just large enough
                 del_free_list_node(NEXT_BLKP(ptr));
                 PUT(HDRP(ptr),PACK(asize,1));
                 PUT(FTRP(ptr),PACK(asize,1));
+                INSTR(++instr.realloc[MM_REALLOC_NEXT]);
                 return ptr;
             }
         }
@@ -314,26 +580,311 @@ void *mm_realloc(void *ptr, size_t size)
                 createAllocBlockWithData(prev_blk,asize,ptr);
                 void * freeptr= NEXT_BLKP(prev_blk);
                 createFreeBlock(freeptr,total_size-asize);
+                INSTR(++instr.realloc[MM_REALLOC_PREV]);
                 return prev_blk;
 
             }
             else if(GET_SIZE(HDRP(prev_blk)) == (asize - cur_size)){//block is just large enough
                 createAllocBlockWithData(prev_blk,asize,ptr);
+                INSTR(++instr.realloc[MM_REALLOC_PREV]);
                 return prev_blk;
             }
         }
     }
     else if(asize==cur_size){
+        INSTR(++instr.realloc[MM_REALLOC_SAME]);
         return ptr;
     }
 
-    //need to copy old data to new block
+    //need to copy old data to new block (only the old payload: the heap may
+    //end right after it)
+    INSTR(++instr.realloc[MM_REALLOC_COPY]);
     int * new = (int *)mm_malloc(size);
-    copy(ptr,new);
+    if(new == NULL){
+        return NULL;
+    }
+    memcpy(new, ptr, cur_size - DSIZE);
     mm_free(ptr);
     return new;
 }
 
+/* mm_halloc
+•allocates a relocatable block of at least size bytes and returns a handle
+to it, or MM_NULL_HANDLE on failure
+•the block may be moved by mm_compact whenever it is not locked, so the
+object must only be accessed through the pointer returned by mm_hlock
+•the first double word of the block holds the handle; the object follows it
+*/
+mm_handle_t mm_halloc(size_t size)
+{
+    mm_handle_t h;
+    char * bp;
+
+    if(size==0 || (free_handle==0 && !grow_handles())){
+        return MM_NULL_HANDLE;
+    }
+    if((bp = mm_malloc(size + DSIZE)) == NULL){
+        return MM_NULL_HANDLE;
+    }
+    h = free_handle;
+    free_handle = handles[h].locks;
+    handles[h].bp = bp;
+    handles[h].locks = 0;
+    PUT(bp,h);
+    return h;
+}
+
+/* mm_hlock
+•pins the object for handle h and returns a pointer to it, which stays valid
+until the matching mm_hunlock
+•locks nest; the object can move again once every lock is released
+*/
+void *mm_hlock(mm_handle_t h)
+{
+    ++handles[h].locks;
+    return handles[h].bp + DSIZE;
+}
+
+/* mm_hunlock
+•releases one lock taken by mm_hlock
+*/
+void mm_hunlock(mm_handle_t h)
+{
+    --handles[h].locks;
+}
+
+/* mm_hfree
+•frees the object for handle h and the handle itself
+*/
+void mm_hfree(mm_handle_t h)
+{
+    mm_free(handles[h].bp);
+    handles[h].bp = NULL;
+    handles[h].locks = free_handle;
+    free_handle = h;
+    if(compact_cursor == h){
+        compact_cursor = 0;
+    }
+}
+
+/* mm_hrealloc
+•resizes the object for handle h with mm_realloc, preserving its contents
+•returns h, or MM_NULL_HANDLE on failure (the old object is left alone)
+•pointers from mm_hlock are invalid afterwards, even if the handle is locked
+*/
+mm_handle_t mm_hrealloc(mm_handle_t h, size_t size)
+{
+    char * bp;
+
+    if(size==0 || (bp = mm_realloc(handles[h].bp, size + DSIZE)) == NULL){
+        return MM_NULL_HANDLE;
+    }
+    handles[h].bp = bp;
+    return h;
+}
+
+/* mm_compact
+•slides unlocked handle blocks down into the free block in front of them,
+so free space collects into fewer, larger blocks further up the heap
+•walks the heap in address order; stops after about usecs microseconds
+(usecs <= 0 means no limit) and the next call resumes where it stopped
+•returns the number of blocks moved
+*/
+int mm_compact(int usecs)
+{
+    struct timeval start, now;
+    char * bp;
+    int moved = 0;
+    int visited = 0;
+
+    if(usecs > 0){
+        gettimeofday(&start,NULL);
+    }
+
+    bp = heap_listp;
+    if(compact_cursor != 0 && handles[compact_cursor].bp != NULL){
+        bp = handles[compact_cursor].bp;
+    }
+
+    for(; GET_SIZE(HDRP(bp)) != 0; bp = NEXT_BLKP(bp)){
+        if(!GET_ALLOC(HDRP(bp)) && is_handle_block(NEXT_BLKP(bp))){
+            bp = slide_block(bp,NEXT_BLKP(bp));
+            ++moved;
+        }
+        if(is_handle_block(bp)){
+            compact_cursor = GET(bp);
+        }
+
+        if(usecs > 0 && ++visited % COMPACT_CHECK == 0){
+            gettimeofday(&now,NULL);
+            if((now.tv_sec - start.tv_sec)*1000000 + (now.tv_usec - start.tv_usec) >= usecs){
+                return moved;
+            }
+        }
+    }
+
+    compact_cursor = 0;//reached the end of the heap, start over next time
+    return moved;
+}
+
+/* mm_set_tunable
+•sets tunable which (MM_SMALL_BLK_SIZE ... in mm.h) to value; takes effect
+from the next request, so it may be called at any time
+•returns 0, or -1 if which is unknown or value is out of its range
+*/
+int mm_set_tunable(int which, int value){
+    if(which < 0 || which >= MM_NUM_TUNABLES ||
+       value < tunables[which].min || value > tunables[which].max){
+        return -1;
+    }
+    tunables[which].value = value;
+    switch(which){//the self-tuned ones also change the policy in force
+    case MM_BEST_FIT_THRESHOLD:
+        policy.best_fit_threshold = value;
+        break;
+    case MM_SMALL_BLK_SIZE:
+        policy.small_blk_size = value;
+        break;
+    }
+    return 0;
+}
+
+/* mm_get_tunable
+•returns the value of tunable which, or -1 if which is unknown
+*/
+int mm_get_tunable(int which){
+    if(which < 0 || which >= MM_NUM_TUNABLES){
+        return -1;
+    }
+    return tunables[which].value;
+}
+
+/* mm_tunable_name
+•returns the name of tunable which, for reports, or NULL if which is unknown
+*/
+const char *mm_tunable_name(int which){
+    if(which < 0 || which >= MM_NUM_TUNABLES){
+        return NULL;
+    }
+    return tunables[which].name;
+}
+
+/* mm_policy
+•fills in p with the policy in force and what the last epoch measured
+*/
+void mm_policy(mm_policy_t * p){
+    *p = policy;
+}
+
+/* mm_set_adaptive
+•turns the self-tuning on (the default) or off. When it is off, the best fit
+threshold and container size stay at their tunable values
+from the next mm_init on
+*/
+void mm_set_adaptive(int on){
+    adaptive = on;
+}
+
+/* mm_freespace
+•fills in fs with the number, total size and largest size of the free
+blocks, found by walking both free lists (main heap and short-lived zones)
+•the unused end of the small block container is marked allocated, so it
+doesn't count as free
+•tail_free is the size of the free block at the end of the heap, if there
+is one: heap extension that no request has used yet
+•used by the driver to see how fragmented the heap is between requests
+*/
+void mm_freespace(mm_freespace_t * fs){
+    void * bp;
+    size_t size;
+    int list;
+    char * last_ftr = (char *)mem_heap_hi() + 1 - DSIZE;//footer of the block before the epilogue
+
+    fs->free_bytes = 0;
+    fs->free_blocks = 0;
+    fs->largest_free = 0;
+    fs->tail_free = GET_ALLOC(last_ftr) ? 0 : GET_SIZE(last_ftr);
+    fs->extends = counts.extends;
+    for(list = 0; list < 2; ++list){
+        bp = (list == 0) ? free_list_head : short_list_head;
+        for(; bp != NULL; bp = (void*)GET(NEXT(bp))){
+            size = GET_SIZE(HDRP(bp));
+            fs->free_bytes += size;
+            ++fs->free_blocks;
+            if(size > fs->largest_free){
+                fs->largest_free = size;
+            }
+        }
+    }
+}
+
+/* mm_stats
+•fills in out with the heap's size, how much of it is live and free, and
+the counts of heap extensions, splits and coalesces since mm_init
+•the counts are kept as the allocator runs; the free bytes take one walk of
+the free lists (see mm_freespace), so this costs O(free blocks)
+•live bytes are the rest of the heap, less the prologue and epilogue and the
+unused end of the small block container
+•mm.c is not thread safe: call it under the same lock as the others
+*/
+void mm_stats(mm_stats_t * out){
+    mm_freespace_t fs;
+
+    memset(out,0,sizeof(*out));
+    if(heap_listp == NULL){//no mm_init yet
+        return;
+    }
+    mm_freespace(&fs);
+    out->heap_bytes = mem_heapsize();
+    out->free_bytes = fs.free_bytes;
+    out->free_blocks = free_list_size;
+    out->live_bytes = out->heap_bytes - fs.free_bytes - 4*WSIZE;
+    if(only_small_blk != NULL){
+        out->live_bytes -= GET_SIZE(HDRP(only_small_blk));
+    }
+    out->extends = counts.extends;
+    out->splits = counts.splits;
+    out->coalesces = counts.coalesces;
+}
+
+/* mm_stats_dump
+•writes mm_stats to fp, one "mm_<name> <value>" line per statistic, or as
+one JSON object if json is set, for scraping by a monitoring agent
+•returns 0, or -1 if the write failed
+*/
+int mm_stats_dump(FILE * fp, int json){
+    mm_stats_t s;
+    const char * fmt = json ?
+        "{\"heap_bytes\": %lu, \"live_bytes\": %lu, \"free_bytes\": %lu, "
+        "\"free_blocks\": %lu, \"extends\": %llu, \"splits\": %llu, "
+        "\"coalesces\": %llu}\n" :
+        "mm_heap_bytes %lu\nmm_live_bytes %lu\nmm_free_bytes %lu\n"
+        "mm_free_blocks %lu\nmm_extends %llu\nmm_splits %llu\n"
+        "mm_coalesces %llu\n";
+
+    mm_stats(&s);
+    if(fprintf(fp, fmt, (unsigned long)s.heap_bytes, (unsigned long)s.live_bytes,
+               (unsigned long)s.free_bytes, (unsigned long)s.free_blocks,
+               s.extends, s.splits, s.coalesces) < 0 || fflush(fp) == EOF){
+        return -1;
+    }
+    return 0;
+}
+
+/* mm_instr
+•copies what the instrumentation recorded since mm_init to out
+•returns 0, or -1 (and zeros) if mm.c was compiled without MM_INSTRUMENT
+*/
+int mm_instr(mm_instr_t * out){
+#ifdef MM_INSTRUMENT
+    *out = instr;
+    return 0;
+#else
+    memset(out,0,sizeof(*out));
+    return -1;
+#endif
+}
+
 /*mm_check
 Used to check for invariants or inconsistencies in the heap.
 CHECKS the following:
@@ -440,6 +991,7 @@ static void * extend_heap(size_t words){
     if((long)(bp = mem_sbrk(size))== -1){
         return NULL;
     }
+    ++counts.extends;
     createFreeBlock(bp,size);
     PUT(HDRP(NEXT_BLKP(bp)), PACK(0,1));
     return coalesce(bp);
@@ -458,21 +1010,27 @@ AFA -> AFA
 •Returns a pointer to the updated free block
 */
 static void * coalesce(void * bp){
+    void * head = bp;//bp was just put at the front of its free list
     size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp)));
     size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
     size_t size= GET_SIZE(HDRP(bp));
 
     if (prev_alloc && next_alloc) {/* Case 1 prev and next block allocated*/
+        INSTR(++instr.coalesce[0]);
         return bp;
     }
 
-    else if (prev_alloc && !next_alloc) {/* Case 2 prev block allocated, next block free*/
+    ++epoch.coalesces;
+    ++counts.coalesces;
+    if (prev_alloc && !next_alloc) {/* Case 2 prev block allocated, next block free*/
+        INSTR(++instr.coalesce[1]);
         del_free_list_node(NEXT_BLKP(bp));
         size+= GET_SIZE(HDRP(NEXT_BLKP(bp)));
         PUT(HDRP(bp), PACK(size,0));
         PUT(FTRP(bp), PACK(size,0));
     }
     else if (!prev_alloc && next_alloc) { /* Case 3 prev block free, next block allocated*/
+        INSTR(++instr.coalesce[2]);
         del_free_list_node(PREV_BLKP(bp));
         PUT(PREV(PREV_BLKP(bp)),GET(PREV(bp)));
         PUT(NEXT(PREV_BLKP(bp)),GET(NEXT(bp)));
@@ -483,9 +1041,14 @@ static void * coalesce(void * bp){
         PUT(FTRP(bp), PACK(size,0));
         PUT(HDRP(PREV_BLKP(bp)), PACK(size,0));
         bp = PREV_BLKP(bp);
-        free_list_head = bp;
+        if(head == short_list_head){
+            short_list_head = bp;
+        }else{
+            free_list_head = bp;
+        }
     }
     else {/* Case 4 both prev and next blocks free*/
+        INSTR(++instr.coalesce[3]);
         size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));
         del_free_list_node(PREV_BLKP(bp));
         del_free_list_node(NEXT_BLKP(bp));
@@ -498,7 +1061,11 @@ static void * coalesce(void * bp){
         PUT(HDRP(PREV_BLKP(bp)), PACK(size,0));
         PUT(FTRP(NEXT_BLKP(bp)), PACK(size,0));
         bp = PREV_BLKP(bp);
-        free_list_head = bp;
+        if(head == short_list_head){
+            short_list_head = bp;
+        }else{
+            free_list_head = bp;
+        }
 
     }
     return bp;
@@ -513,6 +1080,8 @@ static void del_free_list_node(void* bp){
     void * next = (void*)GET(NEXT(bp));
     if(bp == free_list_head){
         free_list_head = next;
+    }else if(bp == short_list_head){
+        short_list_head = next;
     }
     if(prev!=NULL){
         PUT(NEXT(prev), (unsigned int)next);
@@ -525,17 +1094,19 @@ static void del_free_list_node(void* bp){
 }
 
 /*   ins_free_list_node
-•inserts a node into the free list at the beginning
-•updates the free_list_head pointer to point to bp and increases the
+•inserts a node into the free list at the beginning (short_list_head if bp
+is inside a short-lived zone)
+•updates the list head pointer to point to bp and increases the
 size of the free list
 */
 static void ins_free_list_node(void *bp){
-    if(free_list_head!=NULL){
-        PUT(PREV(free_list_head), (unsigned int)bp);
+    void ** head = (num_zones && in_zone(bp)) ? &short_list_head : &free_list_head;
+    if(*head!=NULL){
+        PUT(PREV(*head), (unsigned int)bp);
     }
-    PUT(NEXT(bp), (unsigned int)free_list_head);
+    PUT(NEXT(bp), (unsigned int)*head);
     PUT(PREV(bp), (unsigned int)NULL);
-    free_list_head=bp;
+    *head=bp;
     ++free_list_size;
 }
 
@@ -574,30 +1145,19 @@ static void createAllocBlock(void * bp,size_t size){
 }
 
 /*  createAllocBlockWithData
-•same as createAllocBlock, but also copies data from old block into new block
-•calls copy function
+•same as createAllocBlock, but also moves the payload of the allocated block
+data into it (realloc growing into the free block before data)
+•only the old payload is moved: the new block is larger, and data may end
+right at the end of the heap
 */
 static void createAllocBlockWithData(void * bp,size_t size, void * data){
+    size_t old_size = GET_SIZE(HDRP(data));
     del_free_list_node(bp);
     PUT(HDRP(bp),PACK(size,1));
-    copy(data,bp);
+    memmove(bp, data, old_size - DSIZE);
     PUT(FTRP(bp),PACK(size,1));
 }
 
-/* copy
-•copies contents from b1 to b2
-•stops at FTRP(b2)
-•used to copy data from one block to another (realloc)
-*/
-static void copy(const int* b1, const int* b2){
-    int *end= (int*)FTRP(b2);
-    while(b2!=end){
-        PUT(b2,GET(b1));
-        b2++;
-        b1++;
-    }
-}
-
 /*  find_fit
 finds a usable free block
 •Placement Policy
@@ -609,34 +1169,229 @@ uses a best fit search of the free list to place an allocated block
 •returns a pointer to the free block that can be used
 */
 static void * find_fit(size_t asize){
-    if(free_list_size < BEST_FIT_THRESHOLD){
-        void* bp;
-        void * ret_loc = NULL;
-        unsigned int cur_size=-1;
-        unsigned int tmp_size;
-        for(bp=free_list_head;bp!=NULL; bp = (void*)GET(NEXT(bp))){
-            tmp_size= GET_SIZE(HDRP(bp));
-            if(asize <= tmp_size){
-                if(tmp_size < cur_size){
-                    cur_size=tmp_size;
-                    ret_loc = bp;
+    void* bp;
+    void * first = NULL;//first fit's choice
+    void * ret_loc = NULL;//best fit's choice
+    unsigned int cur_size=-1;
+    unsigned int tmp_size;
+    int best = free_list_size < BEST_FIT_THRESHOLD;
+    int visited = 0;
+
+    //in first fit, now and then search the whole list to see what best fit
+    //would save and cost, unless the list is too long for best fit to pay
+    if(!best && adaptive && free_list_size < PROBE_MAX_LIST && --probe_countdown == 0){
+        probe_countdown = probe_every;
+        best = 1;
+    }
+
+    for(bp=free_list_head;bp!=NULL; bp = (void*)GET(NEXT(bp))){
+        ++visited;
+        tmp_size= GET_SIZE(HDRP(bp));
+        if(asize <= tmp_size){
+            if(first == NULL){
+                first = bp;
+                if(!best){
+                    break;
+                }
+            }
+            if(tmp_size < cur_size){
+                cur_size=tmp_size;
+                ret_loc = bp;
+                if(tmp_size == asize){//nothing fits better
+                    break;
                 }
             }
         }
-        return ret_loc;
     }
-    else{
-        void* bp;
 
-        for(bp=free_list_head;bp!=NULL; bp = (void*)GET(NEXT(bp))){
-            if(asize <= GET_SIZE(HDRP(bp))){
-                return bp;
-            }
-        }
+    epoch.visited += visited;
+    INSTR(++instr.visited[log2_bucket(visited)]);
+    INSTR(++instr.fit[best][first != NULL]);
+    if(first == NULL){
         return NULL;
     }
+    ++epoch.searches;
+    if(!best){
+        return first;
+    }
+    ++epoch.measured;
+    epoch.best_visited += visited;
+    epoch.requested += asize;
+    epoch.saved += GET_SIZE(HDRP(first)) - cur_size;
+    return ret_loc;
 }
 
+/*   extend_size
+•called when no free block fits a request of block size asize; records the
+miss and returns how much to extend the heap by
+•the miss histogram has a class per power of two, each with the decayed
+number of misses and bytes asked for. It decays by 1/MISS_WINDOW per
+request, so a class's count is about its misses in the last MISS_WINDOW
+requests, and it follows the workload's recent phase
+•the extension is asize plus the bytes the next EXTEND_AHEAD requests are
+expected to miss by, counting only the size classes likely to miss at all
+(MISS_LIKELY). A rare huge miss so gets an extension of its own size, a
+bimodal workload doesn't make every extension huge, and a workload that
+mostly reuses freed blocks barely extends ahead
+•the result is kept within MIN_CHUNK and MAX_CHUNK, then the free block at
+the end of the heap, if any, is subtracted: extend_heap coalesces with it
+*/
+static size_t extend_size(size_t asize){
+    int c, cls;
+    size_t s;
+    double share;
+    double ahead = 0;
+    double decay = 1.0 - 1.0/MISS_WINDOW;
+    double scale = 1.0;
+    unsigned int n = requests - miss_decayed;
+    size_t extendsize;
+    char * last_ftr = (char *)mem_heap_hi() + 1 - DSIZE;//footer of the block before the epilogue
+    size_t tail = GET_ALLOC(last_ftr) ? 0 : GET_SIZE(last_ftr);
+
+    //decay by (1 - 1/MISS_WINDOW) for each request since the last miss
+    for(; n != 0 && scale > 0; n >>= 1){
+        if(n & 1){
+            scale *= decay;
+        }
+        decay *= decay;
+    }
+    miss_decayed = requests;
+    for(c = 0; c < MISS_CLASSES; ++c){
+        miss_count[c] *= scale;
+        miss_bytes[c] *= scale;
+    }
+    for(cls = 0, s = asize; (s >>= 1) != 0 && cls < MISS_CLASSES-1; ){
+        ++cls;
+    }
+    miss_count[cls] += 1;
+    miss_bytes[cls] += asize;
+
+    for(c = 0; c < MISS_CLASSES; ++c){
+        share = (double)EXTEND_AHEAD * miss_count[c] / MISS_WINDOW;//expected misses in this class
+        if(share >= MISS_LIKELY){
+            ahead += share * miss_bytes[c] / miss_count[c];
+        }
+    }
+
+    extendsize = asize + ALIGN((size_t)ahead);
+    extendsize = MAX(MIN(extendsize, MAX_CHUNK), MIN_CHUNK);
+    extendsize = MAX(extendsize, asize);
+    return extendsize - MIN(tail, extendsize - MIN_BLOCK_SIZE);
+}
+
+/*   note_request
+•counts a request of block size asize for the self-tuning, and ends the epoch
+every EPOCH_MALLOCS requests
+*/
+static void note_request(size_t asize){
+    if(epoch.mallocs == EPOCH_MALLOCS){
+        adapt();
+    }
+    ++epoch.mallocs;
+    if(asize < SMALL_SIZE){
+        ++epoch.small;
+    }
+}
+
+/*   adapt
+•ends an epoch: records its statistics in policy and adjusts the policy
+•best fit threshold: raised (doubled) while best fit saves more than
+FIT_GAIN_HIGH of the bytes requested and its searches stay under
+SEARCH_BUDGET nodes; lowered (halved, not below the tunable) when it saves
+less than FIT_GAIN_LOW or its searches cost twice the budget. The cost is
+what best fit searches (and probes) visit, not the average over all
+searches: first fit's short searches would hide it
+•probes back off, doubling the searches between them up to PROBE_RARELY,
+while they find best fit doesn't pay
+•container size: doubled when most requests are small, halved when few are,
+within a factor of two of the tunable
+•each change needs HYSTERESIS epochs in a row voting for it
+*/
+static void adapt(void){
+    int vote;
+    int base;
+
+    policy.epochs++;
+    policy.search_len = epoch.searches ? (double)epoch.visited/epoch.searches : 0;
+    policy.best_len = epoch.measured ? (double)epoch.best_visited/epoch.measured : 0;
+    policy.fit_gain = epoch.requested ? (double)epoch.saved/epoch.requested : 0;
+    policy.split_rate = (double)epoch.splits/epoch.mallocs;
+    policy.coalesce_rate = epoch.frees ? (double)epoch.coalesces/epoch.frees : 0;
+    policy.small_frac = (double)epoch.small/epoch.mallocs;
+
+    //fit policy
+    base = tunables[MM_BEST_FIT_THRESHOLD].value;
+    vote = 0;
+    if(epoch.measured > 0 && policy.fit_gain > FIT_GAIN_HIGH &&
+       policy.best_len < SEARCH_BUDGET && policy.best_fit_threshold < MAX_BEST_FIT){
+        vote = 1;
+    }else if(policy.best_fit_threshold > base &&
+             (policy.fit_gain < FIT_GAIN_LOW || policy.best_len > 2*SEARCH_BUDGET)){
+        vote = -1;
+    }
+    //probe less often while probes find best fit doesn't pay, so first fit
+    //isn't slowed by full searches that never change anything
+    if(vote > 0){
+        probe_every = PROBE_EVERY;
+    }else if(epoch.measured > 0 && policy.best_fit_threshold < free_list_size){
+        probe_every = MIN(probe_every*2, PROBE_RARELY);
+    }
+    if(agreed(&fit_votes,vote)){
+        policy.best_fit_threshold = (vote > 0) ?
+            MIN(MAX(policy.best_fit_threshold*2, 8), MAX_BEST_FIT) :
+            MAX(policy.best_fit_threshold/2, base);
+        policy.changes++;
+    }
+
+    //small block container size
+    base = tunables[MM_SMALL_BLK_SIZE].value;
+    vote = 0;
+    if(policy.small_frac > SMALL_HIGH && policy.small_blk_size < 2*base){
+        vote = 1;
+    }else if(policy.small_frac < SMALL_LOW && policy.small_blk_size > base/2){
+        vote = -1;
+    }
+    if(agreed(&small_votes,vote)){
+        policy.small_blk_size = (vote > 0) ? 2*policy.small_blk_size :
+            MAX(policy.small_blk_size/2, tunables[MM_SMALL_BLK_SIZE].min);
+        policy.changes++;
+    }
+
+    memset(&epoch,0,sizeof(epoch));
+}
+
+/*   agreed
+•adds this epoch's vote (1 up, -1 down, 0 neither) to the run of votes;
+returns nonzero, and starts a new run, once HYSTERESIS epochs in a row agree
+*/
+static int agreed(int * votes, int vote){
+    if(vote == 0 || (vote > 0) != (*votes > 0)){
+        *votes = vote;
+    }else{
+        *votes += vote;
+    }
+    if(*votes >= HYSTERESIS || *votes <= -HYSTERESIS){
+        *votes = 0;
+        return 1;
+    }
+    return 0;
+}
+
+#ifdef MM_INSTRUMENT
+/*   log2_bucket
+•the mm_instr_t histogram bucket for v: 0 for 0, b for [2^(b-1), 2^b), and
+the last bucket for anything larger
+*/
+static int log2_bucket(unsigned long long v){
+    int b = 0;
+    while(v != 0 && b < MM_INSTR_BUCKETS-1){
+        v >>= 1;
+        ++b;
+    }
+    return b;
+}
+#endif
+
 /*   place
 •places block of size asize into bp, which is the usable block returned by
 findfit.
@@ -648,11 +1403,15 @@ block.
 static void place(void* bp, size_t asize){
     size_t csize = GET_SIZE(HDRP(bp));
     if((csize - asize) >= MIN_BLOCK_SIZE){
+        ++epoch.splits;
+        ++counts.splits;
+        INSTR(++instr.split[log2_bucket(csize - asize)]);
         createAllocBlock(bp,asize);
         bp=NEXT_BLKP(bp);
         createFreeBlock(bp,csize-asize);
 
     }else{
+        INSTR(++instr.whole);
         createAllocBlock(bp,csize);
     }
 
@@ -676,3 +1435,130 @@ static void place_into_allocated_block(void* bp, size_t asize){
         PUT(FTRP(bp),PACK(csize,1));
     }
 }
+
+/* create_zone
+•allocates a zone for short-lived blocks from the main heap
+•the zone is laid out like the heap in mm_init: a pad word, a prologue
+block, one free block and an epilogue header, so coalescing stops at its edges
+•returns the zone's free block (already on the short list), or NULL
+*/
+static void * create_zone(void){
+    char * zp = mm_malloc(SHORT_ZONE_SIZE);
+    size_t zsize;
+
+    if(zp==NULL){
+        return NULL;
+    }
+    zsize = GET_SIZE(HDRP(zp));
+    PUT(zp,0);
+    PUT(zp + (1*WSIZE), PACK(DSIZE,1));//prologue header
+    PUT(zp + (2*WSIZE), PACK(DSIZE,1));//prologue footer
+    PUT(zp + zsize - DSIZE - WSIZE, PACK(0,1));//epilogue, just before the zone's footer
+    zones[num_zones++] = zp;
+    createFreeBlock(zp + (4*WSIZE), zsize - ZONE_OVERHEAD);
+    return zp + (4*WSIZE);
+}
+
+/* in_zone
+•returns 1 if bp lies inside one of the short-lived zones
+*/
+static int in_zone(void * bp){
+    int i;
+    for(i=0; i<num_zones; i++){
+        if((char *)bp > (char *)zones[i] && (char *)bp < (char *)zones[i] + GET_SIZE(HDRP(zones[i]))){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* release_zone
+•if the free block bp fills a whole short-lived zone, the zone is freed
+back to the main heap
+*/
+static void release_zone(void * bp){
+    int i;
+    for(i=0; i<num_zones; i++){
+        if((char *)zones[i] + (4*WSIZE) == bp && GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0){
+            void * zp = zones[i];
+            del_free_list_node(bp);
+            zones[i] = zones[--num_zones];
+            mm_free(zp);
+            return;
+        }
+    }
+}
+
+/* grow_handles
+•doubles the handle table (it is moved with mm_realloc) and threads the new
+entries onto the free entry list
+•returns 0 if the heap is out of memory
+*/
+static int grow_handles(void){
+    int n = num_handles ? 2*num_handles : HANDLE_TABLE_INIT;
+    int i;
+    handle_entry * table = mm_realloc(handles, n*sizeof(handle_entry));
+
+    if(table==NULL){
+        return 0;
+    }
+    if(num_handles == 0){
+        table[0].bp = NULL;//never handed out
+        table[0].locks = 0;
+    }
+    for(i = n-1; i >= (num_handles ? num_handles : 1); i--){
+        table[i].bp = NULL;
+        table[i].locks = free_handle;
+        free_handle = i;
+    }
+    handles = table;
+    num_handles = n;
+    return 1;
+}
+
+/* is_handle_block
+•returns 1 if bp is an unlocked handle block, i.e. one mm_compact may move
+•a block is a handle block only if its first word names a handle table entry
+that points back at it
+*/
+static int is_handle_block(void * bp){
+    unsigned int h;
+    if(!GET_ALLOC(HDRP(bp)) || GET_SIZE(HDRP(bp)) == 0){
+        return 0;
+    }
+    h = GET(bp);
+    return h > 0 && h < num_handles && handles[h].bp == bp && handles[h].locks == 0;
+}
+
+/* slide_block
+•moves the handle block bp down into the free block fp right before it and
+updates its handle; the free space ends up after the block and is coalesced
+with whatever follows
+•returns the new address of the block
+*/
+static void * slide_block(void * fp, void * bp){
+    size_t fsize = GET_SIZE(HDRP(fp));
+    size_t bsize = GET_SIZE(HDRP(bp));
+
+    del_free_list_node(fp);
+    memmove(fp,bp,bsize - DSIZE);
+    PUT(HDRP(fp),PACK(bsize,1));
+    PUT(FTRP(fp),PACK(bsize,1));
+    handles[GET(fp)].bp = fp;
+    createFreeBlock(NEXT_BLKP(fp),fsize);
+    coalesce(NEXT_BLKP(fp));
+    return fp;
+}
+
+/* adjust_size
+•converts a requested payload size into a block size: room for the header and
+footer, rounded up to a double word, and at least MIN_BLOCK_SIZE
+•shared by mm_malloc, mm_realloc and mm_free_sized so they agree on block sizes
+*/
+static size_t adjust_size(size_t size){
+    size_t asize = ALIGN(size) + DSIZE;
+    if(asize < MIN_BLOCK_SIZE){
+        asize = MIN_BLOCK_SIZE; //Maintain minimum block size
+    }
+    return asize;
+}
@@ -1,9 +1,101 @@
 #include <stdio.h>
 
+/* Lifetime hints for mm_malloc_hint */
+#define MM_SHORT_LIVED 0x1
+#define MM_LONG_LIVED  0x2
+
+/* Relocatable blocks: mm_halloc returns a handle, not a pointer */
+typedef int mm_handle_t;
+#define MM_NULL_HANDLE 0
+
+/* Policy tunables for mm_set_tunable and mm_get_tunable */
+#define MM_SMALL_BLK_SIZE     0 /* size of each small block container */
+#define MM_BEST_FIT_THRESHOLD 1 /* best fit below this many free blocks */
+#define MM_SMALL_SIZE         2 /* blocks below this size are small */
+#define MM_EXTEND_AHEAD       3 /* requests a heap extension looks ahead */
+#define MM_MIN_CHUNK          4 /* least the heap is extended by */
+#define MM_MAX_CHUNK          5 /* most the heap is extended by */
+#define MM_NUM_TUNABLES       6
+
+/* The self-tuned policy in force and the last epoch's statistics, from
+   mm_policy */
+typedef struct {
+    int best_fit_threshold; /* best fit below this many free blocks */
+    int small_blk_size;     /* size of each small block container */
+    int epochs;             /* epochs completed since mm_init */
+    int changes;            /* policy changes made since mm_init */
+    double search_len;      /* free list nodes visited per search */
+    double best_len;        /* the same, for best fit searches only */
+    double fit_gain;        /* bytes best fit saved over first fit, per byte */
+    double split_rate;      /* blocks split per request */
+    double coalesce_rate;   /* frees that merged with a neighbour, per free */
+    double small_frac;      /* fraction of requests that were small */
+} mm_policy_t;
+
+/* Free space in the heap, from mm_freespace */
+typedef struct {
+    size_t free_bytes;   /* bytes in free blocks, headers and footers included */
+    size_t free_blocks;  /* number of free blocks */
+    size_t largest_free; /* size of the largest free block */
+    size_t tail_free;    /* size of the free block at the end of the heap */
+    unsigned long long extends; /* heap extensions since mm_init */
+} mm_freespace_t;
+
+/* Heap statistics, from mm_stats; the counts are since mm_init */
+typedef struct mm_stats {
+    size_t heap_bytes;            /* size of the heap */
+    size_t live_bytes;            /* bytes in allocated blocks, headers included */
+    size_t free_bytes;            /* bytes in free blocks */
+    size_t free_blocks;           /* length of the free lists */
+    unsigned long long extends;   /* heap extensions */
+    unsigned long long splits;    /* free blocks split to place a request */
+    unsigned long long coalesces; /* frees merged with a free neighbour */
+} mm_stats_t;
+
+/* Placement instrumentation, from mm_instr when mm.c is compiled with
+   MM_INSTRUMENT defined (make MM_INSTRUMENT=1). Histogram bucket 0 counts
+   zeros, bucket b counts values in [2^(b-1), 2^b), and the last bucket
+   also takes everything larger */
+#define MM_INSTR_BUCKETS  16
+#define MM_REALLOC_SHRINK 0 /* mm_realloc paths */
+#define MM_REALLOC_NEXT   1 /* grew into the free block after it */
+#define MM_REALLOC_PREV   2 /* grew into the free block before it */
+#define MM_REALLOC_SAME   3
+#define MM_REALLOC_COPY   4 /* moved to a new block */
+#define MM_REALLOC_PATHS  5
+typedef struct {
+    unsigned long long small;      /* requests served by the small block container */
+    unsigned long long fit[2][2];  /* find_fit calls by [first fit, best fit][miss, hit] */
+    unsigned long long visited[MM_INSTR_BUCKETS]; /* find_fit calls by nodes visited */
+    unsigned long long split[MM_INSTR_BUCKETS];   /* place splits by bytes split off */
+    unsigned long long whole;      /* place calls that used the whole block */
+    unsigned long long coalesce[4]; /* coalesce calls: neither, next, prev, both free */
+    unsigned long long realloc[MM_REALLOC_PATHS]; /* mm_realloc calls by path */
+} mm_instr_t;
+
 extern int mm_init (void);
 extern void *mm_malloc (size_t size);
+extern void *mm_malloc_near(void *near, size_t size);
+extern void *mm_malloc_hint(size_t size, int hint);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
+extern void mm_free_sized(void *ptr, size_t size);
+extern size_t mm_usable_size(void *ptr);
+extern mm_handle_t mm_halloc(size_t size);
+extern mm_handle_t mm_hrealloc(mm_handle_t h, size_t size);
+extern void mm_hfree(mm_handle_t h);
+extern void *mm_hlock(mm_handle_t h);
+extern void mm_hunlock(mm_handle_t h);
+extern int mm_compact(int usecs);
+extern void mm_freespace(mm_freespace_t *fs);
+extern int mm_set_tunable(int which, int value);
+extern int mm_get_tunable(int which);
+extern const char *mm_tunable_name(int which);
+extern void mm_policy(mm_policy_t *p);
+extern void mm_set_adaptive(int on);
+extern void mm_stats(mm_stats_t *out);
+extern int mm_stats_dump(FILE *fp, int json);
+extern int mm_instr(mm_instr_t *out);
 
 
 /* 
@@ -0,0 +1,156 @@
+#ifndef __MM_CXX_H_
+#define __MM_CXX_H_
+
+/*
+ * mm_cxx.h - C++ bindings for the mm.c allocator
+ *
+ * Provides a std::pmr::memory_resource (mm::memory_resource) and an
+ * STL-compatible allocator template (mm::allocator<T>) on top of
+ * mm_malloc/mm_free_sized. Both share the single memlib heap, so any two
+ * instances compare equal. Link mm_new.o as well to route global
+ * operator new/delete through the same heap.
+ *
+ * mm.c is not thread safe; neither is anything in this file.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <memory_resource>
+
+extern "C" {
+#include "mm.h"
+#include "memlib.h"
+}
+
+namespace mm {
+
+/* mm_malloc payloads are double-word aligned */
+static const std::size_t min_align = 8;
+
+/*
+ * init - set up the simulated heap and the mm package the first time it
+ *     is called. Returns false if mm_init failed.
+ */
+inline bool init()
+{
+    static int state = 0; /* 0 = not yet, 1 = ready, -1 = mm_init failed */
+
+    if (state == 0) {
+        mem_init();
+        state = (mm_init() < 0) ? -1 : 1;
+    }
+    return state > 0;
+}
+
+/*
+ * reset - throw away every block and start over with an empty heap.
+ *     Only safe when nothing allocated from the heap is still in use.
+ */
+inline bool reset()
+{
+    if (!init())
+        return false;
+    mem_reset_brk();
+    return mm_init() >= 0;
+}
+
+/*
+ * allocate - return size bytes aligned to align (a power of two), or NULL.
+ *     Alignments above min_align over-allocate by align bytes and keep the
+ *     offset back to the mm_malloc block in the word before the payload.
+ */
+inline void *allocate(std::size_t size, std::size_t align)
+{
+    char *p, *q;
+
+    if (size == 0)
+        size = 1; /* mm_malloc(0) returns NULL */
+    if (align <= min_align)
+        return mm_malloc(size);
+
+    if ((p = (char *)mm_malloc(size + align)) == NULL)
+        return NULL;
+    q = (char *)(((std::uintptr_t)p + align) & ~(std::uintptr_t)(align - 1));
+    ((std::size_t *)q)[-1] = q - p;
+    return q;
+}
+
+/*
+ * deallocate - release a block from allocate(). size and align must be
+ *     the values it was allocated with; size 0 means "unknown".
+ */
+inline void deallocate(void *ptr, std::size_t size, std::size_t align)
+{
+    if (ptr == NULL)
+        return;
+    if (align > min_align) {
+        ptr = (char *)ptr - ((std::size_t *)ptr)[-1];
+        if (size != 0)
+            size += align;
+    }
+    if (size == 0)
+        mm_free(ptr);
+    else
+        mm_free_sized(ptr, size);
+}
+
+/*
+ * memory_resource - std::pmr adaptor, for use with std::pmr containers
+ */
+class memory_resource : public std::pmr::memory_resource {
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        void *p;
+
+        if (!init() || (p = mm::allocate(bytes, align)) == NULL)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t align) override
+    {
+        mm::deallocate(p, bytes ? bytes : 1, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return dynamic_cast<const memory_resource *>(&other) != NULL;
+    }
+};
+
+/*
+ * allocator - STL allocator, for std containers that take an Allocator
+ */
+template <class T>
+struct allocator {
+    typedef T value_type;
+
+    allocator() noexcept {}
+    template <class U> allocator(const allocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n)
+    {
+        void *p;
+
+        if (n > (std::size_t)-1 / sizeof(T))
+            throw std::bad_array_new_length();
+        if (!init() || (p = mm::allocate(n * sizeof(T), alignof(T))) == NULL)
+            throw std::bad_alloc();
+        return (T *)p;
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+        mm::deallocate(p, n ? n * sizeof(T) : 1, alignof(T));
+    }
+};
+
+template <class T, class U>
+inline bool operator==(const allocator<T> &, const allocator<U> &) { return true; }
+template <class T, class U>
+inline bool operator!=(const allocator<T> &, const allocator<U> &) { return false; }
+
+} /* namespace mm */
+
+#endif /* __MM_CXX_H_ */
@@ -0,0 +1,134 @@
+/*
+ * mm_new.cc - replace the global operator new/delete with mm.c
+ *
+ * Linking mm_new.o into a C++ program sends every new/delete expression,
+ * including the sized and aligned forms, to mm_malloc/mm_free on the
+ * memlib heap. The heap is set up on the first call. Like mm.c itself this
+ * is single-threaded only.
+ */
+#include <cstddef>
+#include <new>
+
+#include "mm_cxx.h"
+
+/*
+ * mm_new - allocate for operator new; returns NULL on failure
+ */
+static void *mm_new(std::size_t size, std::size_t align)
+{
+    if (!mm::init())
+        return NULL;
+    return mm::allocate(size, align);
+}
+
+void *operator new(std::size_t size)
+{
+    void *p;
+
+    if ((p = mm_new(size, mm::min_align)) == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return mm_new(size, mm::min_align);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return mm_new(size, mm::min_align);
+}
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+    void *p;
+
+    if ((p = mm_new(size, (std::size_t)align)) == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+
+void *operator new(std::size_t size, std::align_val_t align,
+                   const std::nothrow_t &) noexcept
+{
+    return mm_new(size, (std::size_t)align);
+}
+
+void *operator new[](std::size_t size, std::align_val_t align,
+                     const std::nothrow_t &) noexcept
+{
+    return mm_new(size, (std::size_t)align);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    mm::deallocate(ptr, 0, mm::min_align);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    mm::deallocate(ptr, 0, mm::min_align);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    mm::deallocate(ptr, 0, mm::min_align);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    mm::deallocate(ptr, 0, mm::min_align);
+}
+
+void operator delete(void *ptr, std::size_t size) noexcept
+{
+    mm::deallocate(ptr, size ? size : 1, mm::min_align);
+}
+
+void operator delete[](void *ptr, std::size_t size) noexcept
+{
+    mm::deallocate(ptr, size ? size : 1, mm::min_align);
+}
+
+void operator delete(void *ptr, std::align_val_t align) noexcept
+{
+    mm::deallocate(ptr, 0, (std::size_t)align);
+}
+
+void operator delete[](void *ptr, std::align_val_t align) noexcept
+{
+    mm::deallocate(ptr, 0, (std::size_t)align);
+}
+
+void operator delete(void *ptr, std::align_val_t align,
+                     const std::nothrow_t &) noexcept
+{
+    mm::deallocate(ptr, 0, (std::size_t)align);
+}
+
+void operator delete[](void *ptr, std::align_val_t align,
+                       const std::nothrow_t &) noexcept
+{
+    mm::deallocate(ptr, 0, (std::size_t)align);
+}
+
+void operator delete(void *ptr, std::size_t size, std::align_val_t align) noexcept
+{
+    mm::deallocate(ptr, size ? size : 1, (std::size_t)align);
+}
+
+void operator delete[](void *ptr, std::size_t size, std::align_val_t align) noexcept
+{
+    mm::deallocate(ptr, size ? size : 1, (std::size_t)align);
+}
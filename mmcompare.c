@@ -0,0 +1,162 @@
+/*
+ * mmcompare.c - tell whether two mdriver -B runs differ in throughput
+ *
+ *	./mdriver -B 30 -w before.txt
+ *	(change mm.c, rebuild)
+ *	./mdriver -B 30 -w after.txt
+ *	./mmcompare before.txt after.txt
+ *
+ * For each trace in both files it prints the median Kops of each, the
+ * change, a bootstrap confidence interval of the change and the p-value
+ * of a Mann-Whitney U test. A change is called significant only if the
+ * p-value is below alpha and the interval does not include zero.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define MAXLINE 65536 /* longest line of a samples file */
+
+/* The samples of one trace */
+typedef struct {
+    char *name;
+    int n;
+    double *kops;
+} series_t;
+
+/* The traces in one samples file */
+typedef struct {
+    int n;
+    series_t *series;
+} run_t;
+
+/*
+ * read_run - read a samples file written by mdriver -w
+ */
+static void read_run(char *path, run_t *run)
+{
+    FILE *fp;
+    static char line[MAXLINE];
+    char *tok, *end;
+    series_t *s;
+    int max;
+
+    if ((fp = fopen(path, "r")) == NULL) {
+	perror(path);
+	exit(1);
+    }
+    run->n = 0;
+    run->series = NULL;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+	if (line[0] == '#' || (tok = strtok(line, " \t\n")) == NULL)
+	    continue;
+	if ((run->series = realloc(run->series,
+				   (run->n + 1) * sizeof(series_t))) == NULL) {
+	    fprintf(stderr, "mmcompare: out of memory\n");
+	    exit(1);
+	}
+	s = &run->series[run->n++];
+	s->name = strdup(tok);
+	s->n = 0;
+	s->kops = NULL;
+	max = 0;
+	while ((tok = strtok(NULL, " \t\n")) != NULL) {
+	    if (s->n == max) {
+		max = max ? 2 * max : 32;
+		if ((s->kops = realloc(s->kops, max * sizeof(double))) == NULL) {
+		    fprintf(stderr, "mmcompare: out of memory\n");
+		    exit(1);
+		}
+	    }
+	    s->kops[s->n++] = strtod(tok, &end);
+	    if (*end != '\0') {
+		fprintf(stderr, "%s: bad sample \"%s\" for %s\n", path, tok,
+			s->name);
+		exit(1);
+	    }
+	}
+    }
+    fclose(fp);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mmcompare [-h] [-a <alpha>] [-c <conf>] <before> <after>\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-a <alpha> Significance level of the U test (default 0.05).\n");
+    fprintf(stderr, "\t-c <conf>  Confidence level of the intervals (default 0.95).\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+}
+
+int main(int argc, char **argv)
+{
+    int c, i, j, compared = 0, differ = 0;
+    double alpha = 0.05, conf = 0.95;
+    double ma, mb, lo, hi, p;
+    run_t a, b;
+    series_t *sa, *sb;
+    char *verdict;
+
+    while ((c = getopt(argc, argv, "a:c:h")) != EOF) {
+	switch (c) {
+	case 'a':
+	    alpha = atof(optarg);
+	    break;
+	case 'c':
+	    conf = atof(optarg);
+	    if (conf <= 0 || conf >= 1) {
+		fprintf(stderr, "-c needs a level between 0 and 1\n");
+		exit(1);
+	    }
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (argc - optind != 2) {
+	usage();
+	exit(1);
+    }
+    read_run(argv[optind], &a);
+    read_run(argv[optind + 1], &b);
+
+    printf("%-20s%10s%10s%9s%18s%9s\n", "trace", "before", "after",
+	   "change", "CI", "p");
+    for (i = 0; i < a.n; i++) {
+	sa = &a.series[i];
+	for (j = 0; j < b.n && strcmp(b.series[j].name, sa->name) != 0; j++)
+	    ;
+	if (j == b.n) {
+	    printf("%-20s  not in %s\n", sa->name, argv[optind + 1]);
+	    continue;
+	}
+	sb = &b.series[j];
+	ma = bench_median(sa->kops, sa->n);
+	mb = bench_median(sb->kops, sb->n);
+	bench_diff_ci(sa->kops, sa->n, sb->kops, sb->n, conf, &lo, &hi);
+	p = bench_mannwhitney(sa->kops, sa->n, sb->kops, sb->n);
+	if (p < alpha && (lo > 0 || hi < 0)) {
+	    verdict = (mb > ma) ? "faster" : "slower";
+	    differ++;
+	}
+	else
+	    verdict = "~";
+	compared++;
+	printf("%-20s%10.0f%10.0f%+8.1f%%  [%+6.1f%%,%+6.1f%%]%9.4f  %s\n",
+	       sa->name, ma, mb, (mb / ma - 1) * 100, lo * 100, hi * 100, p,
+	       verdict);
+    }
+    printf("%d of %d traces differ significantly (alpha %.3g, %.0f%% CI)\n",
+	   differ, compared, alpha, conf * 100);
+    exit(0);
+}
@@ -0,0 +1,301 @@
+/*
+ * mmshim.c - run ordinary programs on the mm.c allocator
+ *
+ * Build libmmshim.so ("make libmmshim.so"), which links mm.c with the
+ * mmap-backed memlib_mmap.c, and compare a program on both allocators:
+ *
+ *	/usr/bin/time -v ./app                              (glibc)
+ *	/usr/bin/time -v env LD_PRELOAD=./libmmshim.so ./app (mm.c)
+ *
+ * "Elapsed" and "Maximum resident set size" give the end-to-end time and
+ * RSS. MMSHIM_HEAP_MB sets the size of the heap reservation.
+ *
+ * mm.c is single-threaded and its payloads are only 8-byte aligned, so
+ * every call here holds shim_lock, and every block is over-allocated
+ * so that the pointer handed out can be aligned as the ABI (or a
+ * memalign caller) expects. The distance back to the mm_malloc payload
+ * is kept in the word just below that pointer. The heap is set up on
+ * the first call. A call that comes back into the shim from inside it
+ * (the same thread, already holding the lock) is served from a small
+ * static arena instead of deadlocking.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define SHIM_ALIGN (2 * sizeof(void *)) /* malloc's alignment in the ABI */
+#define BOOT_SIZE  (64 * 1024)          /* arena for recursive calls */
+
+static pthread_mutex_t shim_lock = PTHREAD_MUTEX_INITIALIZER;
+static int shim_state;                  /* 0 = not yet, 1 = ready, -1 = failed */
+static char boot[BOOT_SIZE] __attribute__((aligned(16)));
+static size_t boot_used;                /* protected by shim_lock */
+static __thread int in_shim
+    __attribute__((tls_model("initial-exec"))); /* holds shim_lock */
+
+/* function prototypes */
+static void shim_init(void) __attribute__((constructor));
+static void shim_fork_prepare(void);
+static void shim_fork_done(void);
+static int shim_enter(void);
+static void shim_leave(void);
+static void *shim_alloc(size_t size, size_t align);
+static void shim_free(void *ptr);
+static size_t shim_offset(void *ptr);
+static int in_boot(void *ptr);
+static void *boot_alloc(size_t size, size_t align);
+
+/*
+ * shim_init - keep a fork() from copying shim_lock while another
+ *     thread holds it
+ */
+static void shim_init(void)
+{
+    pthread_atfork(shim_fork_prepare, shim_fork_done, shim_fork_done);
+}
+
+static void shim_fork_prepare(void)
+{
+    pthread_mutex_lock(&shim_lock);
+}
+
+static void shim_fork_done(void)
+{
+    pthread_mutex_unlock(&shim_lock);
+}
+
+/*
+ * shim_enter - take the lock and set up the heap the first time.
+ *     Returns 0 if the caller must use the boot arena instead: the call
+ *     is recursive, or the heap could not be set up.
+ */
+static int shim_enter(void)
+{
+    if (in_shim)
+	return 0;
+    pthread_mutex_lock(&shim_lock);
+    in_shim = 1;
+    if (shim_state == 0) {
+	mem_init();
+	shim_state = (mm_init() < 0) ? -1 : 1;
+    }
+    if (shim_state < 0) {
+	shim_leave();
+	return 0;
+    }
+    return 1;
+}
+
+static void shim_leave(void)
+{
+    in_shim = 0;
+    pthread_mutex_unlock(&shim_lock);
+}
+
+/*
+ * shim_alloc - mm_malloc a block aligned to align (a power of two, at
+ *     least SHIM_ALIGN). Called with shim_lock held.
+ */
+static void *shim_alloc(size_t size, size_t align)
+{
+    char *p, *q;
+
+    if (size > (size_t)0x7fffffff - align) /* mm.c sizes are 32 bits */
+	return NULL;
+    if ((p = mm_malloc(size + align)) == NULL)
+	return NULL;
+    q = (char *)(((unsigned long)p + align) & ~(unsigned long)(align - 1));
+    ((size_t *)q)[-1] = q - p;
+    return q;
+}
+
+/*
+ * shim_free - free a block from shim_alloc. Called with shim_lock held.
+ */
+static void shim_free(void *ptr)
+{
+    mm_free((char *)ptr - shim_offset(ptr));
+}
+
+static size_t shim_offset(void *ptr)
+{
+    return ((size_t *)ptr)[-1];
+}
+
+static int in_boot(void *ptr)
+{
+    return (char *)ptr >= boot && (char *)ptr < boot + BOOT_SIZE;
+}
+
+/*
+ * boot_alloc - bump-allocate from the boot arena; its memory is never
+ *     freed or reused. Called with shim_lock held (or for a failed heap,
+ *     where it is all there is).
+ */
+static void *boot_alloc(size_t size, size_t align)
+{
+    size_t start = (boot_used + align - 1) & ~(align - 1);
+
+    if (size > BOOT_SIZE || start > BOOT_SIZE - size) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    boot_used = start + size;
+    return boot + start;
+}
+
+void *malloc(size_t size)
+{
+    void *p;
+
+    if (!shim_enter())
+	return boot_alloc(size, SHIM_ALIGN);
+    if ((p = shim_alloc(size, SHIM_ALIGN)) == NULL)
+	errno = ENOMEM;
+    shim_leave();
+    return p;
+}
+
+void free(void *ptr)
+{
+    if (ptr == NULL || in_boot(ptr))
+	return;
+    if (!shim_enter())
+	return;
+    shim_free(ptr);
+    shim_leave();
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (size && nmemb > (size_t)-1 / size) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    /* Not malloc + memset, which the compiler may turn back into calloc */
+    if (!shim_enter())
+	return boot_alloc(nmemb * size, SHIM_ALIGN); /* starts zeroed */
+    if ((p = shim_alloc(nmemb * size, SHIM_ALIGN)) == NULL)
+	errno = ENOMEM;
+    else
+	memset(p, 0, nmemb * size);
+    shim_leave();
+    return p;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    char *p, *newp;
+    size_t off, newoff, old;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if (size == 0) {
+	free(ptr);
+	return NULL;
+    }
+    if (in_boot(ptr)) {
+	/* move it out of the boot arena */
+	if ((newp = malloc(size)) != NULL)
+	    memcpy(newp, ptr, ((char *)boot + BOOT_SIZE - (char *)ptr < (long)size) ?
+		   (size_t)((char *)boot + BOOT_SIZE - (char *)ptr) : size);
+	return newp;
+    }
+    if (!shim_enter())
+	return NULL;
+
+    off = shim_offset(ptr);
+    p = (char *)ptr - off;
+    old = mm_usable_size(p) - off;
+    if (off > SHIM_ALIGN || size > (size_t)0x7fffffff - SHIM_ALIGN) {
+	/* over-aligned by memalign: move it to an ordinary block */
+	if ((newp = shim_alloc(size, SHIM_ALIGN)) != NULL) {
+	    memcpy(newp, ptr, (old < size) ? old : size);
+	    shim_free(ptr);
+	}
+    }
+    else if ((p = mm_realloc(p, size + SHIM_ALIGN)) == NULL)
+	newp = NULL;
+    else {
+	/* mm_realloc kept the payload's offset; realign it if it moved */
+	newp = (char *)(((unsigned long)p + SHIM_ALIGN) &
+			~(unsigned long)(SHIM_ALIGN - 1));
+	newoff = newp - p;
+	if (newoff != off)
+	    memmove(newp, p + off, (old < size) ? old : size);
+	((size_t *)newp)[-1] = newoff;
+    }
+    shim_leave();
+    if (newp == NULL)
+	errno = ENOMEM;
+    return newp;
+}
+
+int posix_memalign(void **memptr, size_t align, size_t size)
+{
+    void *p;
+
+    if (align < sizeof(void *) || (align & (align - 1)) != 0)
+	return EINVAL;
+    if (align < SHIM_ALIGN)
+	align = SHIM_ALIGN;
+    if (!shim_enter())
+	p = boot_alloc(size, align);
+    else {
+	p = shim_alloc(size, align);
+	shim_leave();
+    }
+    if (p == NULL)
+	return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+void *memalign(size_t align, size_t size)
+{
+    void *p;
+    int err;
+
+    if (align < sizeof(void *))
+	align = sizeof(void *);
+    if ((err = posix_memalign(&p, align, size)) != 0) {
+	errno = err;
+	return NULL;
+    }
+    return p;
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    return memalign(align, size);
+}
+
+void *valloc(size_t size)
+{
+    return memalign(getpagesize(), size);
+}
+
+void *pvalloc(size_t size)
+{
+    size_t page = getpagesize();
+
+    return memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+    size_t n;
+
+    if (ptr == NULL || in_boot(ptr) || !shim_enter())
+	return 0;
+    n = mm_usable_size((char *)ptr - shim_offset(ptr)) - shim_offset(ptr);
+    shim_leave();
+    return n;
+}
@@ -0,0 +1,186 @@
+/*
+ * mmtest.c - regression tests for mm.c
+ *
+ *	make test
+ *
+ * Runs mm.c over memlib_mmap.c, whose heap is made accessible only up to
+ * the brk, so a read or write past the end of the heap faults instead of
+ * landing in the slack of a big malloc'd array as it does under memlib.c.
+ * Every block's contents are checked, so a copy that moves too little
+ * shows up as well. Prints one line per test and exits nonzero if any
+ * of them fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define GROW_SIZE    (64 * 1024)  /* block sizes for test_realloc_prev */
+#define PAD_SIZE     192          /* request test_free_sized frees; gets 200 */
+#define STRESS_OPS   200000       /* requests replayed by test_stress */
+#define STRESS_SLOTS 1024         /* blocks test_stress keeps at once */
+#define STRESS_MAX   (16 * 1024)  /* largest block test_stress asks for */
+#define STRESS_SEED  361
+
+/* One block of test_stress */
+typedef struct {
+    unsigned char *p;
+    size_t size;
+    unsigned char fill;   /* every payload byte is fill */
+} slot_t;
+
+static int failures = 0;
+
+/* function prototypes */
+static int test_realloc_prev(void);
+static int test_free_sized(void);
+static int test_stress(void);
+static int check(unsigned char *p, size_t size, unsigned char fill);
+static void report(char *name, int ok);
+
+int main(void)
+{
+    mem_init();
+
+    /* first, while nothing past the brk has ever been mapped */
+    report("realloc into the previous block at the end of the heap",
+	   test_realloc_prev());
+    report("mm_free_sized of a padded block holding a footer-like word",
+	   test_free_sized());
+    report("random malloc/realloc/free with checked contents",
+	   test_stress());
+    return failures ? 1 : 0;
+}
+
+/*
+ * test_realloc_prev - grow the last block of the heap into the free block
+ *     before it. The old block's payload is smaller than the new one and
+ *     ends at the brk, so copying the new size out of it faults.
+ */
+static int test_realloc_prev(void)
+{
+    unsigned char *x, *y, *r;
+
+    if (mm_init() < 0)
+	return 0;
+    if ((x = mm_malloc(GROW_SIZE)) == NULL ||
+	(y = mm_malloc(GROW_SIZE)) == NULL)
+	return 0;
+    memset(y, 0x5a, GROW_SIZE);
+    if ((char *)mem_heap_hi() - (char *)(y + mm_usable_size(y)) > 64) {
+	printf("(y is not the last block: the test needs updating) ");
+	return 0;
+    }
+    mm_free(x);
+    if ((r = mm_realloc(y, GROW_SIZE + GROW_SIZE / 2)) == NULL)
+	return 0;
+    return check(r, GROW_SIZE, 0x5a);
+}
+
+/*
+ * test_free_sized - free with mm_free_sized a block placed with a double
+ *     word of padding, whose payload holds, where a block of exactly the
+ *     size asked for would keep its footer, the word that footer would be.
+ *     The block's neighbours must come through intact.
+ */
+static int test_free_sized(void)
+{
+    unsigned char *a, *b, *c, *d;
+    unsigned int fake;
+
+    if (mm_init() < 0)
+	return 0;
+    if ((a = mm_malloc(1000)) == NULL || (b = mm_malloc(PAD_SIZE + 8)) == NULL ||
+	(c = mm_malloc(1000)) == NULL)
+	return 0;
+    memset(a, 0xa1, 1000);
+    memset(c, 0xc3, 1000);
+    mm_free(b);
+    if ((d = mm_malloc(PAD_SIZE)) == NULL)
+	return 0;
+    if (mm_usable_size(d) != PAD_SIZE + 8) {
+	printf("(d is not padded: the test needs updating) ");
+	return 0;
+    }
+    fake = (PAD_SIZE + 8) | 1;   /* header and footer of a PAD_SIZE block */
+    memcpy(d + PAD_SIZE, &fake, sizeof(fake));
+    mm_free_sized(d, PAD_SIZE);
+    if ((d = mm_malloc(PAD_SIZE + 8)) == NULL)
+	return 0;
+    memset(d, 0xd4, PAD_SIZE + 8);
+    return check(a, 1000, 0xa1) && check(c, 1000, 0xc3) &&
+	check(d, PAD_SIZE + 8, 0xd4);
+}
+
+/*
+ * test_stress - random mallocs, reallocs and frees of random sizes, with
+ *     every block filled and its contents checked before it is changed
+ */
+static int test_stress(void)
+{
+    slot_t slot[STRESS_SLOTS];
+    slot_t *s;
+    size_t size;
+    int i;
+    unsigned char *p;
+
+    if (mm_init() < 0)
+	return 0;
+    memset(slot, 0, sizeof(slot));
+    srand(STRESS_SEED);
+    for (i = 0; i < STRESS_OPS; i++) {
+	s = &slot[rand() % STRESS_SLOTS];
+	/* sizes spread over powers of two, so small and large mix */
+	size = 1 + rand() % (1 + (STRESS_MAX >> (rand() % 12)));
+	if (s->p != NULL && !check(s->p, s->size, s->fill))
+	    return 0;
+	if (s->p == NULL) {
+	    if ((s->p = mm_malloc(size)) == NULL)
+		return 0;
+	}
+	else if (rand() % 2) {
+	    if ((p = mm_realloc(s->p, size)) == NULL)
+		return 0;
+	    if (!check(p, (size < s->size) ? size : s->size, s->fill))
+		return 0;
+	    s->p = p;
+	}
+	else {
+	    mm_free(s->p);
+	    s->p = NULL;
+	    continue;
+	}
+	s->size = size;
+	s->fill = (unsigned char)i;
+	memset(s->p, s->fill, size);
+    }
+    for (i = 0; i < STRESS_SLOTS; i++)
+	if (slot[i].p != NULL && !check(slot[i].p, slot[i].size, slot[i].fill))
+	    return 0;
+    return 1;
+}
+
+/*
+ * check - return 1 if the size bytes at p all equal fill
+ */
+static int check(unsigned char *p, size_t size, unsigned char fill)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+	if (p[i] != fill) {
+	    printf("(byte %lu of %lu at %p is %#x, not %#x) ", (unsigned long)i,
+		   (unsigned long)size, (void *)p, p[i], fill);
+	    return 0;
+	}
+    return 1;
+}
+
+static void report(char *name, int ok)
+{
+    printf("%s: %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok)
+	failures++;
+}
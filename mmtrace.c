@@ -0,0 +1,458 @@
+/*
+ * mmtrace.c - capture the allocation trace of a running program
+ *
+ * Build libmmtrace.so ("make libmmtrace.so") and run the program as
+ *
+ *	MMTRACE_FILE=app.cap LD_PRELOAD=./libmmtrace.so ./app
+ *
+ * malloc, free, realloc, calloc and the memalign family are passed on to
+ * the C library, and each request is recorded as a caprec_t (trace.h)
+ * with its time and thread. tracecvt turns the capture file into a .rep
+ * or binary trace, and mdriver reads it directly.
+ *
+ * Every block carries a 16-byte capheader_t just below the pointer the
+ * program sees, holding the block's id, so finding the id of a freed
+ * pointer needs no shared table. Records go into a buffer private to
+ * each thread, and a full buffer is appended to the file with a single
+ * write(), so threads never wait for each other. When a thread exits,
+ * its buffer is flushed and passed on, with its thread number, to the
+ * next thread to start, so a program that keeps starting short-lived
+ * threads holds only as many buffers as it ever had threads at once.
+ *
+ * Limits: alignments are recorded as plain allocations; a child made
+ * by fork() is not traced; buffers of threads still running at exit are
+ * flushed as they stand.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "trace.h"
+
+#define CAP_BUFRECS 4096        /* records per thread buffer */
+#define CAP_MAGIC   0x6d6d7472u /* marks a block we allocated */
+#define BOOT_SIZE   4096        /* for dlsym's allocations before init */
+
+/* Sits just below every block handed to the program */
+typedef struct {
+    unsigned long long id;
+    unsigned int offset;        /* from the C library's block to ours */
+    unsigned int magic;         /* CAP_MAGIC */
+} capheader_t;
+
+/* A thread's record buffer; all of them are on a list for exit */
+typedef struct capbuf {
+    struct capbuf *next;
+    unsigned int thread;
+    int in_use;                 /* owned by a running thread? */
+    unsigned int seq;           /* records made under this number so far */
+    int n;                      /* records in buf */
+    caprec_t buf[CAP_BUFRECS];
+} capbuf_t;
+
+/* The C library's functions */
+static void *(*real_malloc)(size_t);
+static void (*real_free)(void *);
+static void *(*real_realloc)(void *, size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_memalign)(size_t, size_t);
+static size_t (*real_usable_size)(void *);
+
+static int fd = -1;                 /* the capture file, -1 if not tracing */
+static unsigned long long next_id;  /* next block id */
+static unsigned int next_thread;    /* next thread number */
+static capbuf_t *all_bufs;          /* every thread's buffer */
+static pthread_key_t buf_key;       /* flushes a buffer at thread exit */
+static char boot[BOOT_SIZE];        /* bump area for dlsym */
+static size_t boot_used;
+
+static __thread capbuf_t *my_buf;   /* this thread's buffer */
+static __thread int in_hook;        /* don't record our own allocations */
+
+/* function prototypes */
+static void cap_init(void) __attribute__((constructor));
+static void cap_fini(void) __attribute__((destructor));
+static void cap_record(int type, unsigned long long id, size_t size);
+static capbuf_t *cap_get_buf(void);
+static void cap_flush(capbuf_t *b);
+static void cap_thread_exit(void *arg);
+static void cap_fork_child(void);
+static void *cap_wrap(char *base, size_t offset);
+static capheader_t *cap_header(void *p);
+static void *boot_alloc(size_t size);
+
+/*
+ * cap_init - find the C library's functions and open the capture file
+ */
+static void cap_init(void)
+{
+    char *path = getenv("MMTRACE_FILE");
+    char defpath[64];
+
+    if (real_malloc != NULL)
+	return;
+    in_hook = 1;
+    real_malloc = (void *(*)(size_t))dlsym(RTLD_NEXT, "malloc");
+    real_free = (void (*)(void *))dlsym(RTLD_NEXT, "free");
+    real_realloc = (void *(*)(void *, size_t))dlsym(RTLD_NEXT, "realloc");
+    real_calloc = (void *(*)(size_t, size_t))dlsym(RTLD_NEXT, "calloc");
+    real_memalign = (void *(*)(size_t, size_t))dlsym(RTLD_NEXT, "memalign");
+    real_usable_size = (size_t (*)(void *))dlsym(RTLD_NEXT,
+						 "malloc_usable_size");
+
+    if (path == NULL) {
+	snprintf(defpath, sizeof(defpath), "mmtrace.%d.cap", (int)getpid());
+	path = defpath;
+    }
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644)) < 0 ||
+	write(fd, CAPTURE_MAGIC, 8) != 8) {
+	perror(path);
+	fd = -1;
+    }
+    pthread_key_create(&buf_key, cap_thread_exit);
+    pthread_atfork(NULL, NULL, cap_fork_child);
+    in_hook = 0;
+}
+
+/*
+ * cap_fini - flush every buffer and close the capture file
+ */
+static void cap_fini(void)
+{
+    capbuf_t *b;
+
+    if (fd < 0)
+	return;
+    for (b = __atomic_load_n(&all_bufs, __ATOMIC_ACQUIRE); b; b = b->next)
+	cap_flush(b);
+    close(fd);
+    fd = -1;
+}
+
+/*
+ * cap_record - append a record to this thread's buffer, getting the
+ *     buffer on the thread's first request
+ */
+static void cap_record(int type, unsigned long long id, size_t size)
+{
+    capbuf_t *b = my_buf;
+    caprec_t *r;
+    struct timespec ts;
+
+    if (fd < 0)
+	return;
+    if (b == NULL && (b = cap_get_buf()) == NULL)
+	return;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    r = &b->buf[b->n];
+    r->time = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    r->id = id;
+    r->size = (size > 0x7fffffff) ? 0x7fffffff : size;
+    r->seq = b->seq++;
+    r->thread = b->thread;
+    r->type = type;
+    memset(r->pad, 0, sizeof(r->pad));
+    if (++b->n == CAP_BUFRECS)
+	cap_flush(b);
+}
+
+/*
+ * cap_get_buf - give this thread the buffer of a thread that has exited,
+ *     or a new one if there is none
+ */
+static capbuf_t *cap_get_buf(void)
+{
+    capbuf_t *b;
+    int idle;
+
+    for (b = __atomic_load_n(&all_bufs, __ATOMIC_ACQUIRE); b; b = b->next) {
+	idle = 0;
+	if (__atomic_compare_exchange_n(&b->in_use, &idle, 1, 0,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+	    break;
+    }
+    if (b == NULL) {
+	b = mmap(NULL, sizeof(capbuf_t), PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (b == MAP_FAILED)
+	    return NULL;
+	b->in_use = 1;
+	b->thread = __atomic_fetch_add(&next_thread, 1, __ATOMIC_RELAXED);
+	b->next = __atomic_load_n(&all_bufs, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&all_bufs, &b->next, b, 0,
+					    __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	    ;
+    }
+    my_buf = b;
+    pthread_setspecific(buf_key, b);
+    return b;
+}
+
+/*
+ * cap_flush - append a buffer's records to the capture file
+ */
+static void cap_flush(capbuf_t *b)
+{
+    if (b->n > 0 && fd >= 0 &&
+	write(fd, b->buf, b->n * sizeof(caprec_t)) < 0)
+	perror("mmtrace");
+    b->n = 0;
+}
+
+/*
+ * cap_thread_exit - flush an exiting thread's buffer and let the next
+ *     thread to start have it. Should the thread record more after this,
+ *     it gets a buffer again.
+ */
+static void cap_thread_exit(void *arg)
+{
+    capbuf_t *b = (capbuf_t *)arg;
+
+    cap_flush(b);
+    my_buf = NULL;
+    __atomic_store_n(&b->in_use, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * cap_fork_child - stop tracing in a forked child, which would otherwise
+ *     repeat its parent's ids and unflushed records
+ */
+static void cap_fork_child(void)
+{
+    if (fd >= 0)
+	close(fd);
+    fd = -1;
+}
+
+/*
+ * cap_wrap - give the C library's block at base, with our header at
+ *     offset - sizeof(capheader_t), a new id; returns the program's pointer
+ */
+static void *cap_wrap(char *base, size_t offset)
+{
+    capheader_t *h;
+
+    if (base == NULL)
+	return NULL;
+    h = (capheader_t *)(base + offset) - 1;
+    h->id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+    h->offset = offset;
+    h->magic = CAP_MAGIC;
+    return base + offset;
+}
+
+/*
+ * cap_header - header of a block we handed out, or NULL if p is not one
+ */
+static capheader_t *cap_header(void *p)
+{
+    capheader_t *h = (capheader_t *)p - 1;
+
+    if (p == NULL || ((char *)p >= boot && (char *)p < boot + BOOT_SIZE) ||
+	h->magic != CAP_MAGIC)
+	return NULL;
+    return h;
+}
+
+/*
+ * boot_alloc - allocations made by dlsym before we have real_malloc
+ */
+static void *boot_alloc(size_t size)
+{
+    void *p;
+
+    size = (size + 15) & ~(size_t)15;
+    if (boot_used + size > BOOT_SIZE)
+	return NULL;
+    p = boot + boot_used;
+    boot_used += size;
+    return p;
+}
+
+void *malloc(size_t size)
+{
+    void *p;
+
+    if (real_malloc == NULL) {
+	if (in_hook)
+	    return boot_alloc(size);
+	cap_init();
+    }
+    if (size > (size_t)-1 - sizeof(capheader_t))
+	return NULL;
+    p = cap_wrap(real_malloc(size + sizeof(capheader_t)),
+		 sizeof(capheader_t));
+    if (p != NULL && !in_hook) {
+	in_hook = 1;
+	cap_record(ALLOC, cap_header(p)->id, size);
+	in_hook = 0;
+    }
+    return p;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (real_calloc == NULL) {
+	if (in_hook)
+	    return boot_alloc(nmemb * size); /* boot[] starts zeroed */
+	cap_init();
+    }
+    if (size && nmemb > ((size_t)-1 - sizeof(capheader_t)) / size) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    p = cap_wrap(real_calloc(1, nmemb * size + sizeof(capheader_t)),
+		 sizeof(capheader_t));
+    if (p != NULL && !in_hook) {
+	in_hook = 1;
+	cap_record(ALLOC, cap_header(p)->id, nmemb * size);
+	in_hook = 0;
+    }
+    return p;
+}
+
+void free(void *ptr)
+{
+    capheader_t *h;
+
+    if (ptr == NULL || (h = cap_header(ptr)) == NULL) {
+	/* not ours: dlsym's boot memory is never freed */
+	if (ptr != NULL && !((char *)ptr >= boot && (char *)ptr < boot + BOOT_SIZE))
+	    real_free(ptr);
+	return;
+    }
+    if (!in_hook) {
+	in_hook = 1;
+	cap_record(FREE, h->id, 0);
+	in_hook = 0;
+    }
+    h->magic = 0;
+    real_free((char *)ptr - h->offset);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    capheader_t *h, saved;
+    char *base;
+    void *p;
+    size_t old;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if ((h = cap_header(ptr)) == NULL) {
+	if ((char *)ptr >= boot && (char *)ptr < boot + BOOT_SIZE) {
+	    /* move dlsym's boot memory to a real block */
+	    if ((p = malloc(size)) != NULL)
+		memcpy(p, ptr, (boot + BOOT_SIZE - (char *)ptr < (long)size) ?
+		       (size_t)(boot + BOOT_SIZE - (char *)ptr) : size);
+	    return p;
+	}
+	return real_realloc(ptr, size);
+    }
+    if (size == 0) {
+	free(ptr);
+	return NULL;
+    }
+    if (size > (size_t)-1 - h->offset)
+	return NULL;
+
+    saved = *h;
+    base = (char *)ptr - h->offset;
+    if (h->offset == sizeof(capheader_t)) {
+	/* the header stays at the front of the C library's block */
+	if ((base = real_realloc(base, size + sizeof(capheader_t))) == NULL)
+	    return NULL;
+	p = base + sizeof(capheader_t);
+    }
+    else {
+	/* an over-aligned block: copy into a plain one */
+	if ((p = cap_wrap(real_malloc(size + sizeof(capheader_t)),
+			  sizeof(capheader_t))) == NULL)
+	    return NULL;
+	old = real_usable_size(base) - saved.offset;
+	memcpy(p, ptr, (old < size) ? old : size);
+	h->magic = 0;
+	real_free(base);
+	saved.offset = sizeof(capheader_t);
+    }
+    *((capheader_t *)p - 1) = saved; /* same id as before */
+
+    if (!in_hook) {
+	in_hook = 1;
+	cap_record(REALLOC, saved.id, size);
+	in_hook = 0;
+    }
+    return p;
+}
+
+void *memalign(size_t align, size_t size)
+{
+    void *p;
+
+    if (align <= sizeof(capheader_t))
+	return malloc(size);
+    if (real_memalign == NULL)
+	cap_init();
+    if ((align & (align - 1)) != 0 || size > (size_t)-1 - align) {
+	errno = EINVAL;
+	return NULL;
+    }
+    /* The header goes in the first align bytes, below the aligned block */
+    p = cap_wrap(real_memalign(align, size + align), align);
+    if (p != NULL && !in_hook) {
+	in_hook = 1;
+	cap_record(ALLOC, cap_header(p)->id, size);
+	in_hook = 0;
+    }
+    return p;
+}
+
+int posix_memalign(void **memptr, size_t align, size_t size)
+{
+    void *p;
+
+    if (align < sizeof(void *) || (align & (align - 1)) != 0)
+	return EINVAL;
+    if ((p = memalign(align, size)) == NULL)
+	return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    return memalign(align, size);
+}
+
+void *valloc(size_t size)
+{
+    return memalign(sysconf(_SC_PAGESIZE), size);
+}
+
+void *pvalloc(size_t size)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+
+    return memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+    capheader_t *h;
+
+    if ((h = cap_header(ptr)) == NULL)
+	return 0;
+    return real_usable_size((char *)ptr - h->offset) - h->offset;
+}
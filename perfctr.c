@@ -0,0 +1,116 @@
+/*
+ * perfctr.c - hardware performance counters, see perfctr.h
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "perfctr.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define CACHE_EVENT(cache, op, result) \
+    ((cache) | ((op) << 8) | ((result) << 16))
+
+/* type and config of each event, indexed like perfctr_t.fd */
+static struct {
+    unsigned type;
+    unsigned long long config;
+} events[PC_NUM] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D,
+				     PERF_COUNT_HW_CACHE_OP_READ,
+				     PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB,
+				     PERF_COUNT_HW_CACHE_OP_READ,
+				     PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+#endif
+
+int perfctr_open(perfctr_t *pc)
+{
+    int i, n = 0;
+
+    pc->err = 0;
+#ifdef __linux__
+    struct perf_event_attr attr;
+
+    for (i = 0; i < PC_NUM; i++) {
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = events[i].type;
+	attr.config = events[i].config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1; /* also allowed at perf_event_paranoid 2 */
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+	    PERF_FORMAT_TOTAL_TIME_RUNNING;
+	pc->fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (pc->fd[i] >= 0)
+	    n++;
+	else if (pc->err == 0)
+	    pc->err = errno;
+	pc->count[i] = -1;
+    }
+#else
+    for (i = 0; i < PC_NUM; i++) {
+	pc->fd[i] = -1;
+	pc->count[i] = -1;
+    }
+    pc->err = ENOSYS;
+#endif
+    return n;
+}
+
+void perfctr_start(perfctr_t *pc)
+{
+#ifdef __linux__
+    int i;
+
+    for (i = 0; i < PC_NUM; i++)
+	if (pc->fd[i] >= 0) {
+	    ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+void perfctr_stop(perfctr_t *pc)
+{
+    int i;
+#ifdef __linux__
+    unsigned long long v[3]; /* value, time enabled, time running */
+
+    for (i = 0; i < PC_NUM; i++)
+	if (pc->fd[i] >= 0)
+	    ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    for (i = 0; i < PC_NUM; i++) {
+	pc->count[i] = -1;
+#ifdef __linux__
+	if (pc->fd[i] < 0 || read(pc->fd[i], v, sizeof(v)) != sizeof(v) ||
+	    v[2] == 0)
+	    continue;
+	/* Scale up for the time the counter was multiplexed out */
+	pc->count[i] = (double)v[0] * ((double)v[1] / (double)v[2]);
+#endif
+    }
+}
+
+void perfctr_close(perfctr_t *pc)
+{
+    int i;
+
+    for (i = 0; i < PC_NUM; i++)
+	if (pc->fd[i] >= 0) {
+	    close(pc->fd[i]);
+	    pc->fd[i] = -1;
+	}
+}
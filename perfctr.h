@@ -0,0 +1,42 @@
+#ifndef __PERFCTR_H_
+#define __PERFCTR_H_
+
+/*
+ * perfctr.h - hardware performance counters through perf_event_open
+ *
+ * Each event is opened on its own, so the ones the CPU, kernel or
+ * perf_event_paranoid setting allow are counted and the rest report
+ * as unavailable. Counts are scaled up if the kernel had to multiplex
+ * the counters. Off Linux nothing is available.
+ */
+
+/* The events, in the order they are kept and printed */
+enum {
+    PC_CYCLES,
+    PC_INSTRUCTIONS,
+    PC_L1D_MISSES,   /* L1 data cache read misses */
+    PC_LLC_MISSES,   /* last level cache misses */
+    PC_DTLB_MISSES,  /* data TLB read misses */
+    PC_BRANCH_MISSES,
+    PC_NUM
+};
+
+typedef struct {
+    int fd[PC_NUM];          /* -1 if the event is unavailable */
+    double count[PC_NUM];    /* results of the last perfctr_stop */
+    int err;                 /* errno of the first event that failed */
+} perfctr_t;
+
+/* Open the counters for this thread, stopped; returns how many opened */
+int perfctr_open(perfctr_t *pc);
+
+/* Zero and start the open counters */
+void perfctr_start(perfctr_t *pc);
+
+/* Stop the counters and read them into pc->count (-1 if unavailable) */
+void perfctr_stop(perfctr_t *pc);
+
+/* Close the counters */
+void perfctr_close(perfctr_t *pc);
+
+#endif /* __PERFCTR_H_ */
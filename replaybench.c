@@ -0,0 +1,59 @@
+/*
+ * replaybench.c - time a trace compiled by tracec
+ *
+ *	make replaybench TRACE=traces/binary-bal.rep
+ *	./replaybench
+ *
+ * Runs the generated replay() on a fresh heap under fsecs, exactly as
+ * mdriver times eval_mm_speed, and prints the time and throughput.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "fsecs.h"
+
+int verbose = 0; /* read by fsecs.c */
+
+/* Defined by the code tracec generates */
+extern const char *replay_trace;
+extern const int replay_ops;
+void replay(void);
+
+/*
+ * replay_fail - called by the generated code when a request fails
+ */
+void replay_fail(int op)
+{
+    printf("%s: request %d failed\n", replay_trace, op);
+    exit(1);
+}
+
+/*
+ * run - replay the trace once on an empty heap, as eval_mm_speed does
+ */
+static void run(void *arg)
+{
+    mem_reset_brk();
+    if (mm_init() < 0) {
+	printf("mm_init failed\n");
+	exit(1);
+    }
+    replay();
+}
+
+int main(int argc, char **argv)
+{
+    double secs;
+
+    if (argc > 1 && argv[1][0] == '-' && argv[1][1] == 'v')
+	verbose = 1;
+
+    mem_init();
+    init_fsecs();
+    secs = fsecs(run, NULL);
+    printf("%s: %d ops, %.6f secs, %.0f Kops\n", replay_trace, replay_ops,
+	   secs, (replay_ops/1e3)/secs);
+    exit(0);
+}
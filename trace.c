@@ -0,0 +1,623 @@
+/*
+ * trace.c - read and write malloc lab trace files
+ *
+ * Text (.rep) traces are parsed into a malloc'd array of requests.
+ * Binary traces (see trace.h) are mmap'd and their request records are
+ * used in place, so even very large traces load without copying.
+ * Capture files from mmtrace.c are sorted and renumbered into a trace.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+#define MAXLINE 1024 /* max string size */
+
+/* Largest binary trace or capture file read_trace loads: a quarter of the
+   address space, so a -m32 build finds room to map it. Larger traces are
+   streamed (open_trace_stream), which reads them a window at a time. */
+#define TRACE_MAP_MAX ((size_t)-1 / 4)
+
+extern int verbose; /* -v option of the program using us */
+
+/*
+ * State of a streamed trace. The reader thread fills buf[0] and buf[1]
+ * in turn while the replay works through the other one; full[b] says
+ * buf[b] holds a window the replay hasn't taken yet.
+ */
+struct trace_stream {
+    FILE *tracefile;           /* open trace, positioned at the first op */
+    int binary;                /* is it a binary trace? */
+    long remaining;            /* binary records not yet read */
+    char path[MAXLINE];        /* for error messages */
+    traceop_t *buf[2];         /* the two windows */
+    int count[2];              /* ops in each window (0 = end of trace) */
+    int full[2];               /* is buf[b] waiting to be replayed? */
+    int next;                  /* window the replay takes next */
+    int held;                  /* window the replay is using, or -1 */
+    int stop;                  /* tells the reader to quit early */
+    pthread_t reader;          /* the prefetching thread */
+    pthread_mutex_t lock;      /* protects count, full and stop */
+    pthread_cond_t cond;       /* signalled when any of them changes */
+};
+
+/* function prototypes */
+static void read_trace_rep(trace_t *trace, FILE *tracefile, char *path);
+static void read_trace_bin(trace_t *trace, int fd, char *path);
+static void read_trace_capture(trace_t *trace, FILE *tracefile, char *path);
+static int caprec_cmp(const void *a, const void *b);
+static int capid_cmp(const void *a, const void *b);
+static int read_op_rep(FILE *tracefile, traceop_t *op, int *tid,
+		       char *path);
+static void *stream_reader(void *arg);
+static void trace_error(char *msg, char *path);
+
+/*
+ * read_trace - read a trace file and store it in memory. Binary traces
+ *     and capture files are recognized by their magic numbers, anything
+ *     else is parsed as a .rep file.
+ */
+trace_t *read_trace(char *tracedir, char *filename)
+{
+    FILE *tracefile;
+    trace_t *trace;
+    char path[MAXLINE];
+    char magic[sizeof(((tracehdr_t *)0)->magic)];
+
+    if (verbose > 1)
+	printf("Reading tracefile: %s\n", filename);
+
+    /* Allocate the trace record */
+    if ((trace = (trace_t *) malloc(sizeof(trace_t))) == NULL)
+	trace_error("malloc 1 failed in read_trace", NULL);
+    trace->map_size = 0;
+    trace->threads = NULL;
+    trace->num_threads = 1;
+
+    strcpy(path, tracedir);
+    strcat(path, filename);
+    if ((tracefile = fopen(path, "r")) == NULL)
+	trace_error("Could not open tracefile", path);
+
+    if (fread(magic, 1, sizeof(magic), tracefile) != sizeof(magic))
+	memset(magic, 0, sizeof(magic));
+    if (memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0)
+	read_trace_bin(trace, fileno(tracefile), path);
+    else if (memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) == 0)
+	read_trace_capture(trace, tracefile, path);
+    else {
+	rewind(tracefile);
+	read_trace_rep(trace, tracefile, path);
+    }
+    fclose(tracefile);
+
+    /* We'll keep an array of pointers to the allocated blocks here... */
+    if ((trace->blocks =
+	 (char **)malloc(trace->num_ids * sizeof(char *))) == NULL)
+	trace_error("malloc 3 failed in read_trace", NULL);
+
+    /* ... along with the corresponding byte sizes of each block */
+    if ((trace->block_sizes =
+	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
+	trace_error("malloc 4 failed in read_trace", NULL);
+
+    return trace;
+}
+
+/*
+ * free_trace - Free the trace record and the three arrays it points
+ *              to, all of which were allocated (or mapped) in read_trace().
+ */
+void free_trace(trace_t *trace)
+{
+    if (trace->map_size)      /* unmap or free the requests... */
+	munmap((char *)trace->ops - sizeof(tracehdr_t), trace->map_size);
+    else {
+	free(trace->ops);
+	free(trace->threads);
+    }
+    free(trace->blocks);      /* ...and the other two arrays... */
+    free(trace->block_sizes);
+    free(trace);              /* and the trace record itself... */
+}
+
+/*
+ * write_trace_rep - write a trace as a text .rep file
+ */
+int write_trace_rep(trace_t *trace, char *path)
+{
+    FILE *fp;
+    traceop_t *op;
+    int i;
+
+    if ((fp = fopen(path, "w")) == NULL)
+	return -1;
+    fprintf(fp, "%d\n%d\n%d\n%d\n", trace->sugg_heapsize, trace->num_ids,
+	    trace->num_ops, trace->weight);
+    for (i = 0; i < trace->num_ops; i++) {
+	op = &trace->ops[i];
+	if (trace->threads != NULL)
+	    fprintf(fp, "%d ", trace->threads[i]);
+	switch (op->type) {
+	case ALLOC:
+	    fprintf(fp, "a %d %d\n", op->index, op->size);
+	    break;
+	case REALLOC:
+	    fprintf(fp, "r %d %d\n", op->index, op->size);
+	    break;
+	case FREE:
+	    fprintf(fp, "f %d\n", op->index);
+	    break;
+	}
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/*
+ * write_trace_bin - write a trace as a binary trace file
+ */
+int write_trace_bin(trace_t *trace, char *path)
+{
+    FILE *fp;
+    tracehdr_t hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.version = TRACE_VERSION;
+    hdr.sugg_heapsize = trace->sugg_heapsize;
+    hdr.num_ids = trace->num_ids;
+    hdr.num_ops = trace->num_ops;
+    hdr.weight = trace->weight;
+    hdr.num_threads = (trace->threads != NULL) ? trace->num_threads : 0;
+
+    if ((fp = fopen(path, "wb")) == NULL)
+	return -1;
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	fwrite(trace->ops, sizeof(traceop_t), trace->num_ops, fp) !=
+	(size_t)trace->num_ops ||
+	(trace->threads != NULL &&
+	 fwrite(trace->threads, sizeof(unsigned short), trace->num_ops, fp) !=
+	 (size_t)trace->num_ops)) {
+	fclose(fp);
+	return -1;
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/*
+ * read_trace_rep - parse a text trace into a malloc'd array of requests
+ */
+static void read_trace_rep(trace_t *trace, FILE *tracefile, char *path)
+{
+    unsigned max_index = 0;
+    unsigned op_index;
+    int tid;
+
+    /* Read the trace file header */
+    fscanf(tracefile, "%d", &(trace->sugg_heapsize)); /* not used */
+    fscanf(tracefile, "%d", &(trace->num_ids));
+    fscanf(tracefile, "%d", &(trace->num_ops));
+    fscanf(tracefile, "%d", &(trace->weight));        /* not used */
+
+    /* We'll store each request line in the trace in this array */
+    if ((trace->ops =
+	 (traceop_t *)malloc(trace->num_ops * sizeof(traceop_t))) == NULL)
+	trace_error("malloc 2 failed in read_trace", NULL);
+
+    /* read every request line in the trace file */
+    op_index = 0;
+    while (read_op_rep(tracefile, &trace->ops[op_index], &tid, path)) {
+	/* The thread id array appears with the first tagged request */
+	if (tid != 0 && trace->threads == NULL &&
+	    (trace->threads = (unsigned short *)
+	     calloc(trace->num_ops, sizeof(unsigned short))) == NULL)
+	    trace_error("calloc failed in read_trace", NULL);
+	if (trace->threads != NULL) {
+	    trace->threads[op_index] = tid;
+	    if (tid >= trace->num_threads)
+		trace->num_threads = tid + 1;
+	}
+	if (trace->ops[op_index].type != FREE)
+	    max_index = (trace->ops[op_index].index > max_index) ?
+		trace->ops[op_index].index : max_index;
+	op_index++;
+    }
+    assert(max_index == trace->num_ids - 1);
+    assert(trace->num_ops == op_index);
+}
+
+/*
+ * read_op_rep - parse the next request line of a text trace into op,
+ *     and its thread id (0 if untagged) into *tid. Returns 0 at the end
+ *     of the file.
+ */
+static int read_op_rep(FILE *tracefile, traceop_t *op, int *tid,
+		       char *path)
+{
+    char type[MAXLINE];
+    unsigned index, size;
+
+    if (fscanf(tracefile, "%s", type) == EOF)
+	return 0;
+
+    /* An optional leading thread id */
+    *tid = 0;
+    if (type[0] >= '0' && type[0] <= '9') {
+	*tid = atoi(type);
+	if (*tid > 0xffff || fscanf(tracefile, "%s", type) == EOF) {
+	    printf("Bad thread id (%s) in tracefile %s\n", type, path);
+	    exit(1);
+	}
+    }
+
+    switch(type[0]) {
+    case 'a':
+	fscanf(tracefile, "%u %u", &index, &size);
+	op->type = ALLOC;
+	op->index = index;
+	op->size = size;
+	break;
+    case 'r':
+	fscanf(tracefile, "%u %u", &index, &size);
+	op->type = REALLOC;
+	op->index = index;
+	op->size = size;
+	break;
+    case 'f':
+	fscanf(tracefile, "%ud", &index);
+	op->type = FREE;
+	op->index = index;
+	op->size = 0;
+	break;
+    default:
+	printf("Bogus type character (%c) in tracefile %s\n",
+	       type[0], path);
+	exit(1);
+    }
+    return 1;
+}
+
+/*
+ * read_trace_bin - map a binary trace and point trace->ops at its
+ *     request records
+ */
+static void read_trace_bin(trace_t *trace, int fd, char *path)
+{
+    struct stat st;
+    tracehdr_t *hdr;
+    char *map;
+    int i, num_threads;
+
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(tracehdr_t))
+	trace_error("Could not stat binary tracefile", path);
+    if (st.st_size > (off_t)TRACE_MAP_MAX) {
+	errno = EFBIG;
+	trace_error("Binary tracefile too large to load; stream it instead:", path);
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+	trace_error("Could not mmap binary tracefile", path);
+
+    hdr = (tracehdr_t *)map;
+    errno = EINVAL; /* for the format errors below */
+    if (hdr->version < 1 || hdr->version > TRACE_VERSION)
+	trace_error("Unsupported binary trace version in", path);
+    num_threads = (hdr->version < 2) ? 0 : hdr->num_threads;
+    if (st.st_size != (off_t)sizeof(tracehdr_t) +
+	(off_t)hdr->num_ops * (off_t)(sizeof(traceop_t) +
+				      (num_threads ? sizeof(unsigned short) : 0)))
+	trace_error("Truncated binary tracefile", path);
+
+    trace->sugg_heapsize = hdr->sugg_heapsize;
+    trace->num_ids = hdr->num_ids;
+    trace->num_ops = hdr->num_ops;
+    trace->weight = hdr->weight;
+    trace->ops = (traceop_t *)(map + sizeof(tracehdr_t));
+    trace->map_size = st.st_size;
+    if (num_threads) {
+	trace->threads = (unsigned short *)(trace->ops + trace->num_ops);
+	trace->num_threads = num_threads;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    /* The replay loops index blocks[] with these, so check them once */
+    for (i = 0; i < trace->num_ops; i++)
+	if (trace->ops[i].index >= trace->num_ids ||
+	    trace->ops[i].type > REALLOC ||
+	    (trace->threads && trace->threads[i] >= trace->num_threads))
+	    trace_error("Bad request record in binary tracefile", path);
+}
+
+/*
+ * read_trace_capture - turn the records of a capture file into a trace:
+ *     order them by time, number the blocks in order of allocation and
+ *     the threads in order of their capture numbers, and drop requests
+ *     on blocks whose allocation wasn't captured
+ */
+static void read_trace_capture(trace_t *trace, FILE *tracefile, char *path)
+{
+    caprec_t *recs;
+    unsigned long long (*ids)[2]; /* (capture id, trace id) by capture id */
+    unsigned long long (*tids)[2]; /* the same for thread numbers */
+    unsigned long long key[2], (*found)[2];
+    struct stat st;
+    long n, i, nallocs = 0, nthreads = 0;
+    int op = 0;
+
+    if (fstat(fileno(tracefile), &st) < 0)
+	trace_error("Could not stat capture file", path);
+    if (st.st_size > (off_t)TRACE_MAP_MAX / 3) { /* recs, ops and the maps */
+	errno = EFBIG;
+	trace_error("Capture file too large to load:", path);
+    }
+    n = (st.st_size - 8) / sizeof(caprec_t);
+    if ((recs = (caprec_t *)malloc(n * sizeof(caprec_t) + 1)) == NULL ||
+	(ids = malloc(n * sizeof(*ids) + 1)) == NULL ||
+	(tids = malloc(n * sizeof(*tids) + 1)) == NULL ||
+	(trace->ops = (traceop_t *)malloc(n * sizeof(traceop_t) + 1)) == NULL ||
+	(trace->threads = (unsigned short *)
+	 malloc(n * sizeof(unsigned short) + 1)) == NULL)
+	trace_error("malloc failed in read_trace_capture", NULL);
+    if ((long)fread(recs, sizeof(caprec_t), n, tracefile) != n)
+	trace_error("Could not read capture file", path);
+
+    /* Records from different threads arrive in flush order */
+    qsort(recs, n, sizeof(caprec_t), caprec_cmp);
+
+    for (i = 0; i < n; i++)
+	if (recs[i].type == ALLOC) {
+	    ids[nallocs][0] = recs[i].id;
+	    ids[nallocs][1] = nallocs;
+	    nallocs++;
+	}
+    qsort(ids, nallocs, sizeof(*ids), capid_cmp);
+
+    /* Thread numbers are 32 bits in a capture but 16 in a trace */
+    for (i = 0; i < n; i++)
+	tids[i][0] = recs[i].thread;
+    qsort(tids, n, sizeof(*tids), capid_cmp);
+    for (i = 0; i < n; i++)
+	if (i == 0 || tids[i][0] != tids[nthreads - 1][0]) {
+	    tids[nthreads][0] = tids[i][0];
+	    tids[nthreads][1] = nthreads;
+	    nthreads++;
+	}
+    if (nthreads > (1 << 16)) {
+	errno = EINVAL;
+	trace_error("More threads than a trace can number in", path);
+    }
+
+    trace->num_threads = 1;
+    for (i = 0; i < n; i++) {
+	errno = EINVAL;
+	if (recs[i].type > REALLOC)
+	    trace_error("Bad record in capture file", path);
+	key[0] = recs[i].id;
+	if ((found = bsearch(key, ids, nallocs, sizeof(*ids),
+			     capid_cmp)) == NULL)
+	    continue; /* its allocation wasn't captured */
+	trace->ops[op].type = recs[i].type;
+	trace->ops[op].index = (*found)[1];
+	trace->ops[op].size = recs[i].size;
+	key[0] = recs[i].thread;
+	found = bsearch(key, tids, nthreads, sizeof(*tids), capid_cmp);
+	trace->threads[op] = (*found)[1];
+	if ((*found)[1] >= trace->num_threads)
+	    trace->num_threads = (*found)[1] + 1;
+	op++;
+    }
+    if (trace->num_threads == 1) {
+	free(trace->threads);
+	trace->threads = NULL;
+    }
+
+    trace->sugg_heapsize = 0;
+    trace->num_ids = nallocs;
+    trace->num_ops = op;
+    trace->weight = 1;
+    free(recs);
+    free(ids);
+    free(tids);
+}
+
+/*
+ * caprec_cmp - order capture records by time, then by thread and seq
+ */
+static int caprec_cmp(const void *a, const void *b)
+{
+    const caprec_t *x = (const caprec_t *)a, *y = (const caprec_t *)b;
+
+    if (x->time != y->time)
+	return (x->time < y->time) ? -1 : 1;
+    if (x->thread != y->thread)
+	return (x->thread < y->thread) ? -1 : 1;
+    return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+/*
+ * capid_cmp - order (capture id, trace id) pairs, or the same for
+ *     thread numbers, by capture id
+ */
+static int capid_cmp(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+
+    return (x < y) ? -1 : (x > y);
+}
+
+/*
+ * open_trace_stream - open a trace for streaming replay and start the
+ *     thread that prefetches its ops. The header fields of *trace are
+ *     filled in; ops and the per-id arrays are left unset.
+ */
+trace_stream_t *open_trace_stream(char *tracedir, char *filename,
+				  trace_t *trace)
+{
+    trace_stream_t *s;
+    tracehdr_t hdr;
+
+    if (verbose > 1)
+	printf("Streaming tracefile: %s\n", filename);
+
+    if ((s = (trace_stream_t *)calloc(1, sizeof(trace_stream_t))) == NULL ||
+	(s->buf[0] = (traceop_t *)malloc(STREAM_WINDOW * sizeof(traceop_t))) == NULL ||
+	(s->buf[1] = (traceop_t *)malloc(STREAM_WINDOW * sizeof(traceop_t))) == NULL)
+	trace_error("malloc failed in open_trace_stream", NULL);
+
+    strcpy(s->path, tracedir);
+    strcat(s->path, filename);
+    if ((s->tracefile = fopen(s->path, "r")) == NULL)
+	trace_error("Could not open tracefile", s->path);
+
+    /* Read the header of either format */
+    if (fread(&hdr, 1, sizeof(hdr), s->tracefile) < sizeof(hdr.magic))
+	memset(&hdr, 0, sizeof(hdr));
+    if (memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) == 0) {
+	errno = EINVAL;
+	if (hdr.version < 1 || hdr.version > TRACE_VERSION)
+	    trace_error("Unsupported binary trace version in", s->path);
+	s->binary = 1;
+	s->remaining = hdr.num_ops;
+	trace->sugg_heapsize = hdr.sugg_heapsize;
+	trace->num_ids = hdr.num_ids;
+	trace->num_ops = hdr.num_ops;
+	trace->weight = hdr.weight;
+    }
+    else if (memcmp(hdr.magic, CAPTURE_MAGIC, sizeof(hdr.magic)) == 0) {
+	errno = EINVAL;
+	trace_error("Convert capture files with tracecvt before streaming",
+		    s->path);
+    }
+    else {
+	rewind(s->tracefile);
+	fscanf(s->tracefile, "%d", &(trace->sugg_heapsize));
+	fscanf(s->tracefile, "%d", &(trace->num_ids));
+	fscanf(s->tracefile, "%d", &(trace->num_ops));
+	fscanf(s->tracefile, "%d", &(trace->weight));
+    }
+    trace->ops = NULL;
+    trace->blocks = NULL;
+    trace->block_sizes = NULL;
+    trace->map_size = 0;
+    trace->threads = NULL;
+    trace->num_threads = 1;
+
+    s->held = -1;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    if (pthread_create(&s->reader, NULL, stream_reader, s) != 0)
+	trace_error("Could not start the trace reader thread for", s->path);
+    return s;
+}
+
+/*
+ * next_trace_window - hand the replay the next window of ops, waiting
+ *     for the reader if it hasn't finished it yet. The previous window
+ *     goes back to the reader. Returns the number of ops in *ops, or 0
+ *     at the end of the trace.
+ */
+int next_trace_window(trace_stream_t *s, traceop_t **ops)
+{
+    int b = s->next;
+
+    pthread_mutex_lock(&s->lock);
+    if (s->held >= 0) {
+	s->full[s->held] = 0;
+	s->held = -1;
+	pthread_cond_broadcast(&s->cond);
+    }
+    while (!s->full[b])
+	pthread_cond_wait(&s->cond, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+
+    if (s->count[b] == 0)
+	return 0;
+    s->held = b;
+    s->next = !b;
+    *ops = s->buf[b];
+    return s->count[b];
+}
+
+/*
+ * close_trace_stream - stop the reader thread and free the stream
+ */
+void close_trace_stream(trace_stream_t *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->stop = 1;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->reader, NULL);
+
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->cond);
+    fclose(s->tracefile);
+    free(s->buf[0]);
+    free(s->buf[1]);
+    free(s);
+}
+
+/*
+ * stream_reader - body of the reader thread: fill each window in turn
+ *     as soon as the replay gives it back. A window of 0 ops marks the
+ *     end of the trace.
+ */
+static void *stream_reader(void *arg)
+{
+    trace_stream_t *s = (trace_stream_t *)arg;
+    int b = 0;
+    int n, stop, tid;
+
+    for (;;) {
+	pthread_mutex_lock(&s->lock);
+	while (s->full[b] && !s->stop)
+	    pthread_cond_wait(&s->cond, &s->lock);
+	stop = s->stop;
+	pthread_mutex_unlock(&s->lock);
+	if (stop)
+	    return NULL;
+
+	/* Read the window without holding the lock */
+	if (s->binary) {
+	    n = fread(s->buf[b], sizeof(traceop_t),
+		      (s->remaining < STREAM_WINDOW) ? s->remaining : STREAM_WINDOW,
+		      s->tracefile);
+	    s->remaining -= n;
+	}
+	else
+	    for (n = 0; n < STREAM_WINDOW &&
+		     read_op_rep(s->tracefile, &s->buf[b][n], &tid, s->path);
+		 n++)
+		;
+
+	pthread_mutex_lock(&s->lock);
+	s->count[b] = n;
+	s->full[b] = 1;
+	pthread_cond_broadcast(&s->cond);
+	pthread_mutex_unlock(&s->lock);
+	if (n == 0)
+	    return NULL;
+	b = !b;
+    }
+}
+
+/*
+ * trace_error - Report a trace error and quit
+ */
+static void trace_error(char *msg, char *path)
+{
+    if (path != NULL)
+	printf("%s %s: %s\n", msg, path, strerror(errno));
+    else
+	printf("%s: %s\n", msg, strerror(errno));
+    exit(1);
+}
@@ -0,0 +1,109 @@
+#ifndef __TRACE_H_
+#define __TRACE_H_
+
+/*
+ * trace.h - malloc lab trace files
+ *
+ * A trace is either a text .rep file (four header numbers, then one
+ * "a id size", "r id size" or "f id" line per request) or a binary file:
+ * a tracehdr_t followed by num_ops packed traceop_t records, in host byte
+ * order. Binary traces are mmap'd and replayed in place.
+ *
+ * Traces of multithreaded programs tag each request with the thread that
+ * made it: a .rep line may start with a thread id ("2 a 17 64"), and a
+ * binary trace with nonzero num_threads has num_ops unsigned shorts of
+ * thread ids after the records. Untagged requests belong to thread 0.
+ */
+#include <stddef.h>
+
+/* Types of trace operations (traceop_t.type) */
+enum {ALLOC, FREE, REALLOC};
+
+/*
+ * Characterizes a single trace operation (allocator request). This is
+ * also the 8-byte record of a binary trace: the first word holds the
+ * type in its low 2 bits and the index above them, the second the size.
+ */
+typedef struct {
+    unsigned type : 2;   /* type of request: ALLOC, FREE or REALLOC */
+    unsigned index : 30; /* index for free() to use later */
+    int size;            /* byte size of alloc/realloc request */
+} traceop_t;
+
+/* Holds the information for one trace file*/
+typedef struct {
+    int sugg_heapsize;   /* suggested heap size (unused) */
+    int num_ids;         /* number of alloc/realloc ids */
+    int num_ops;         /* number of distinct requests */
+    int weight;          /* weight for this trace (unused) */
+    traceop_t *ops;      /* array of requests */
+    char **blocks;       /* array of ptrs returned by malloc/realloc... */
+    size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+    size_t map_size;     /* if nonzero, ops lives in an mmap'd binary trace */
+    unsigned short *threads; /* thread of each request, or NULL if untagged */
+    int num_threads;     /* 1 + the largest thread id (1 if untagged) */
+} trace_t;
+
+/* Header of a binary trace file */
+#define TRACE_MAGIC   "MMTRACE"  /* 7 chars + NUL fill magic[] */
+#define TRACE_VERSION 2  /* 1 had no thread ids; still readable */
+typedef struct {
+    char magic[8];       /* TRACE_MAGIC */
+    int version;         /* TRACE_VERSION */
+    int sugg_heapsize;   /* same four fields as the .rep header */
+    int num_ids;
+    int num_ops;
+    int weight;
+    int num_threads;     /* 0 if there are no thread ids after the records */
+    int reserved[2];     /* zero; pads the header to 40 bytes */
+} tracehdr_t;
+
+/*
+ * Capture files, written by the mmtrace.c preload library, hold raw
+ * records of a running program's requests: CAPTURE_MAGIC, then caprec_t
+ * records in the order each thread flushed them. Ids are only unique,
+ * not dense, and times are CLOCK_MONOTONIC nanoseconds; read_trace sorts
+ * the records by time and renumbers the ids and threads.
+ */
+#define CAPTURE_MAGIC "MMCAPT2"  /* 7 chars + NUL fill 8 bytes; 1 had
+				    16-bit thread numbers */
+typedef struct {
+    unsigned long long time;    /* when the request was made, in ns */
+    unsigned long long id;      /* block id, unique for the process */
+    unsigned int size;          /* byte size of alloc/realloc request */
+    unsigned int seq;           /* record number within its thread */
+    unsigned int thread;        /* thread that made the request */
+    unsigned char type;         /* ALLOC, FREE or REALLOC */
+    unsigned char pad[3];       /* zero; pads the record to 32 bytes */
+} caprec_t;
+
+/* Read a text or binary trace or a capture file (the format is detected
+   from the file) */
+trace_t *read_trace(char *tracedir, char *filename);
+
+/* Free a trace returned by read_trace */
+void free_trace(trace_t *trace);
+
+/* Write a trace in text or binary form; return 0 on success, -1 on error */
+int write_trace_rep(trace_t *trace, char *path);
+int write_trace_bin(trace_t *trace, char *path);
+
+/*
+ * Streaming replay for traces too large to load: ops arrive in windows
+ * of up to STREAM_WINDOW, read ahead by a background thread. Thread ids
+ * are not streamed.
+ */
+#define STREAM_WINDOW (1<<16)
+typedef struct trace_stream trace_stream_t;
+
+/* Open a text or binary trace and fill in the header fields of *trace */
+trace_stream_t *open_trace_stream(char *tracedir, char *filename,
+				  trace_t *trace);
+
+/* Point *ops at the next window; return its length, or 0 at the end */
+int next_trace_window(trace_stream_t *s, traceop_t **ops);
+
+/* Stop reading and free the stream */
+void close_trace_stream(trace_stream_t *s);
+
+#endif /* __TRACE_H_ */
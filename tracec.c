@@ -0,0 +1,118 @@
+/*
+ * tracec.c - compile a malloc lab trace into straight-line C
+ *
+ * The output defines replay(), which makes the trace's requests as
+ * plain calls with constant sizes:
+ *
+ *	b[3] = mm_malloc(2040); if (b[3] == NULL) replay_fail(17);
+ *	mm_free(b[1]);
+ *
+ * Link it with replaybench.o and mm.o (see "make replaybench") to time
+ * the allocator without mdriver's decode-and-dispatch loop, the way an
+ * application would call it. The calls are split into functions of
+ * OPS_PER_FUNC requests (-n) so the compiler copes with long traces.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define OPS_PER_FUNC 1000 /* default requests per generated function */
+
+int verbose = 0; /* read by trace.c */
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: tracec [-h] [-n <ops>] <trace> <out.c>\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-n <ops>   Requests per generated function (default %d).\n",
+	    OPS_PER_FUNC);
+}
+
+int main(int argc, char **argv)
+{
+    int c, i, f, nfuncs;
+    int per_func = OPS_PER_FUNC;
+    trace_t *trace;
+    traceop_t *op;
+    FILE *fp;
+
+    while ((c = getopt(argc, argv, "hn:")) != EOF) {
+	switch (c) {
+	case 'n':
+	    per_func = atoi(optarg);
+	    if (per_func < 1) {
+		fprintf(stderr, "-n needs a positive number of ops\n");
+		exit(1);
+	    }
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (argc - optind != 2) {
+	usage();
+	exit(1);
+    }
+
+    trace = read_trace("", argv[optind]);
+    if ((fp = fopen(argv[optind + 1], "w")) == NULL) {
+	perror(argv[optind + 1]);
+	exit(1);
+    }
+    nfuncs = (trace->num_ops + per_func - 1) / per_func;
+
+    fprintf(fp, "/* Generated by tracec from %s: %d ops on %d ids */\n",
+	    argv[optind], trace->num_ops, trace->num_ids);
+    fprintf(fp, "#include <stddef.h>\n#include \"mm.h\"\n\n");
+    fprintf(fp, "void replay_fail(int op);\n\n");
+    fprintf(fp, "const char *replay_trace = \"%s\";\n", argv[optind]);
+    fprintf(fp, "const int replay_ops = %d;\n\n", trace->num_ops);
+    fprintf(fp, "static char *b[%d];\n", trace->num_ids > 0 ? trace->num_ids : 1);
+
+    for (f = 0; f < nfuncs; f++) {
+	fprintf(fp, "\nstatic void replay_%d(void)\n{\n", f);
+	for (i = f * per_func; i < trace->num_ops && i < (f + 1) * per_func; i++) {
+	    op = &trace->ops[i];
+	    switch (op->type) {
+	    case ALLOC:
+		fprintf(fp, "    b[%d] = mm_malloc(%d); if (b[%d] == NULL) "
+			"replay_fail(%d);\n", op->index, op->size, op->index, i);
+		break;
+	    case REALLOC:
+		fprintf(fp, "    b[%d] = mm_realloc(b[%d], %d); if (b[%d] == NULL) "
+			"replay_fail(%d);\n", op->index, op->index, op->size,
+			op->index, i);
+		break;
+	    case FREE:
+		fprintf(fp, "    mm_free(b[%d]);\n", op->index);
+		break;
+	    }
+	}
+	fprintf(fp, "}\n");
+    }
+
+    fprintf(fp, "\n/* Make every request in the trace, in order */\n");
+    fprintf(fp, "void replay(void)\n{\n");
+    for (f = 0; f < nfuncs; f++)
+	fprintf(fp, "    replay_%d();\n", f);
+    fprintf(fp, "}\n");
+
+    if (fclose(fp) != 0) {
+	perror(argv[optind + 1]);
+	exit(1);
+    }
+    if (verbose)
+	printf("%d ops in %d functions\n", trace->num_ops, nfuncs);
+    free_trace(trace);
+    exit(0);
+}
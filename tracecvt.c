@@ -0,0 +1,76 @@
+/*
+ * tracecvt.c - convert malloc lab traces between the text .rep format
+ *     and the binary format described in trace.h
+ *
+ * By default the output is in whichever format the input is not.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+int verbose = 0; /* read by trace.c */
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: tracecvt [-hbrv] <infile> <outfile>\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-b         Write a binary trace.\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-r         Write a text (.rep) trace.\n");
+    fprintf(stderr, "\t-v         Print the trace header.\n");
+}
+
+int main(int argc, char **argv)
+{
+    int c;
+    int binary = -1;   /* write binary (1), text (0) or the other one (-1) */
+    trace_t *trace;
+    int ret;
+
+    while ((c = getopt(argc, argv, "hbrv")) != EOF) {
+	switch (c) {
+	case 'b':
+	    binary = 1;
+	    break;
+	case 'r':
+	    binary = 0;
+	    break;
+	case 'v':
+	    verbose = 2;
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (argc - optind != 2) {
+	usage();
+	exit(1);
+    }
+
+    trace = read_trace("", argv[optind]);
+    if (binary < 0)
+	binary = (trace->map_size == 0);
+    if (verbose)
+	printf("%d ids, %d ops -> %s\n", trace->num_ids, trace->num_ops,
+	       binary ? "binary" : "text");
+
+    if (binary)
+	ret = write_trace_bin(trace, argv[optind + 1]);
+    else
+	ret = write_trace_rep(trace, argv[optind + 1]);
+    if (ret < 0) {
+	perror(argv[optind + 1]);
+	exit(1);
+    }
+    free_trace(trace);
+    exit(0);
+}
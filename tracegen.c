@@ -0,0 +1,368 @@
+/*
+ * tracegen.c - generate synthetic malloc lab traces
+ *
+ * Each request either allocates a new block, reallocs a live one, or
+ * frees the live block whose sampled lifetime has run out first. Sizes
+ * and lifetimes come from the distributions given on the command line;
+ * giving several of either, with -p, switches between them in phases.
+ * With -H the live payload is held near a target by freeing blocks
+ * early. Every block still live at the end is freed, so the trace is
+ * balanced like the -bal traces. The same seed gives the same trace.
+ *
+ * Distributions are written as name:params, e.g.
+ *	uniform:16:512       uniform on [16, 512]
+ *	pow:16:65536:1.5     power law with exponent 1.5, truncated to the range
+ *	bimodal:32:4096:0.9  32 with probability 0.9, else 4096
+ *	set:16,24,32,48      one of the listed values, all equally likely
+ *	exp:1000             exponential with mean 1000 (lifetimes)
+ *	fixed:500            always 500
+ * Lifetimes are counted in requests.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "trace.h"
+
+#define MAX_DISTS 16     /* -d or -l options per run */
+#define MAX_SET   64     /* values in a set: distribution */
+#define MAX_SIZE  (1<<26) /* realloc growth stops here */
+
+/* One distribution, parsed from name:params */
+typedef struct {
+    enum {D_UNIFORM, D_POW, D_BIMODAL, D_SET, D_EXP, D_FIXED} kind;
+    double a, b, c;      /* parameters, by kind: see parse_dist */
+    int n;               /* values in set */
+    int set[MAX_SET];
+} dist_t;
+
+/* A live block. The live blocks form a min-heap on death. */
+typedef struct {
+    int id;
+    int size;
+    long death;          /* request number after which it is freed */
+} block_t;
+
+int verbose = 0; /* read by trace.c */
+
+static unsigned long long rng_state; /* xorshift64* state, from -s */
+
+/* function prototypes */
+static double uniform01(void);
+static int sample(dist_t *d);
+static int parse_dist(char *spec, dist_t *d);
+static void heap_push(block_t *heap, int *n, block_t b);
+static block_t heap_pop(block_t *heap, int *n);
+static void sift_down(block_t *heap, int n, int i);
+static traceop_t *emit(trace_t *trace, int *cap);
+static void usage(void);
+
+int main(int argc, char **argv)
+{
+    dist_t sizes[MAX_DISTS], lifetimes[MAX_DISTS];
+    int nsizes = 0, nlifetimes = 0;
+    long nreqs = 100000;        /* requests before the final frees (-n) */
+    long phase_len = 0;         /* requests per phase, 0 = one phase (-p) */
+    long target = 0;            /* live payload to stay under, 0 = none (-H) */
+    double realloc_p = 0;       /* chance a request is a realloc (-r) */
+    double growth = 1.5;        /* realloc size factor (-g) */
+    int binary = 0;             /* write a binary trace (-b) */
+    unsigned long long seed = 1;
+
+    trace_t trace;
+    traceop_t *op;
+    block_t *heap, b;
+    int nlive = 0, cap = 0, phase, c;
+    long t, live_bytes = 0;
+
+    while ((c = getopt(argc, argv, "bd:g:hH:l:n:p:r:s:v")) != EOF) {
+	switch (c) {
+	case 'b':
+	    binary = 1;
+	    break;
+	case 'd':
+	case 'l':
+	    if ((c == 'd' ? nsizes : nlifetimes) == MAX_DISTS ||
+		parse_dist(optarg, (c == 'd') ? &sizes[nsizes++] :
+			   &lifetimes[nlifetimes++]) < 0) {
+		fprintf(stderr, "tracegen: bad distribution %s\n", optarg);
+		exit(1);
+	    }
+	    break;
+	case 'g':
+	    growth = atof(optarg);
+	    break;
+	case 'H':
+	    target = atol(optarg);
+	    break;
+	case 'n':
+	    nreqs = atol(optarg);
+	    break;
+	case 'p':
+	    phase_len = atol(optarg);
+	    break;
+	case 'r':
+	    realloc_p = atof(optarg);
+	    break;
+	case 's':
+	    seed = strtoull(optarg, NULL, 0);
+	    break;
+	case 'v':
+	    verbose = 1;
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (argc - optind != 1 || nreqs < 1) {
+	usage();
+	exit(1);
+    }
+    if (nsizes == 0)
+	parse_dist("pow:8:4096:1.5", &sizes[nsizes++]);
+    if (nlifetimes == 0)
+	parse_dist("exp:1000", &lifetimes[nlifetimes++]);
+    rng_state = seed ? seed : 1; /* xorshift must not start at 0 */
+
+    memset(&trace, 0, sizeof(trace));
+    trace.weight = 1;
+    trace.num_threads = 1;
+    if ((heap = (block_t *)malloc((nreqs + 1) * sizeof(block_t))) == NULL) {
+	perror("tracegen");
+	exit(1);
+    }
+
+    for (t = 0; t < nreqs; t++) {
+	phase = phase_len ? t / phase_len : 0;
+	op = emit(&trace, &cap);
+
+	if (nlive > 0 && (heap[0].death <= t ||
+			  (target && live_bytes > target))) {
+	    /* The next block to die, or the oldest one if over target */
+	    b = heap_pop(heap, &nlive);
+	    op->type = FREE;
+	    op->index = b.id;
+	    op->size = 0;
+	    live_bytes -= b.size;
+	}
+	else if (nlive > 0 && uniform01() < realloc_p) {
+	    /* Grow (or shrink, if growth < 1) a random live block */
+	    block_t *r = &heap[(int)(uniform01() * nlive)];
+	    int size = (int)(r->size * growth);
+
+	    if (size < 1)
+		size = 1;
+	    if (size > MAX_SIZE)
+		size = MAX_SIZE;
+	    op->type = REALLOC;
+	    op->index = r->id;
+	    op->size = size;
+	    live_bytes += size - r->size;
+	    r->size = size;
+	}
+	else {
+	    b.id = trace.num_ids++;
+	    b.size = sample(&sizes[phase % nsizes]);
+	    b.death = t + sample(&lifetimes[phase % nlifetimes]);
+	    heap_push(heap, &nlive, b);
+	    op->type = ALLOC;
+	    op->index = b.id;
+	    op->size = b.size;
+	    live_bytes += b.size;
+	}
+    }
+
+    /* Free what is left, in order of death */
+    while (nlive > 0) {
+	b = heap_pop(heap, &nlive);
+	op = emit(&trace, &cap);
+	op->type = FREE;
+	op->index = b.id;
+	op->size = 0;
+    }
+
+    if (verbose)
+	printf("%d ids, %d ops -> %s\n", trace.num_ids, trace.num_ops,
+	       argv[optind]);
+    if ((binary ? write_trace_bin(&trace, argv[optind]) :
+	 write_trace_rep(&trace, argv[optind])) < 0) {
+	perror(argv[optind]);
+	exit(1);
+    }
+    free(trace.ops);
+    free(heap);
+    exit(0);
+}
+
+/*
+ * uniform01 - uniform random double in [0, 1), from xorshift64*
+ */
+static double uniform01(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return ((rng_state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * sample - draw a value (at least 1) from distribution d
+ */
+static int sample(dist_t *d)
+{
+    double u = uniform01(), v, lo, hi;
+
+    switch (d->kind) {
+    case D_UNIFORM:
+	v = d->a + u * (d->b - d->a + 1);
+	break;
+    case D_POW:
+	/* Inverse CDF of x^-c truncated to [a, b] */
+	lo = d->a;
+	hi = d->b;
+	if (d->c == 1)
+	    v = lo * pow(hi / lo, u);
+	else
+	    v = pow(pow(lo, 1 - d->c) +
+		    u * (pow(hi, 1 - d->c) - pow(lo, 1 - d->c)), 1 / (1 - d->c));
+	break;
+    case D_BIMODAL:
+	v = (u < d->c) ? d->a : d->b;
+	break;
+    case D_SET:
+	v = d->set[(int)(u * d->n)];
+	break;
+    case D_EXP:
+	v = -d->a * log(1 - u);
+	break;
+    default: /* D_FIXED */
+	v = d->a;
+	break;
+    }
+    return (v < 1) ? 1 : (v > MAX_SIZE) ? MAX_SIZE : (int)v;
+}
+
+/*
+ * parse_dist - parse "name:params" into d; returns -1 if it is malformed
+ */
+static int parse_dist(char *spec, dist_t *d)
+{
+    char *p, *end;
+
+    memset(d, 0, sizeof(*d));
+    if (sscanf(spec, "uniform:%lf:%lf", &d->a, &d->b) == 2)
+	d->kind = D_UNIFORM;
+    else if (sscanf(spec, "pow:%lf:%lf:%lf", &d->a, &d->b, &d->c) == 3)
+	d->kind = D_POW;
+    else if (sscanf(spec, "bimodal:%lf:%lf:%lf", &d->a, &d->b, &d->c) == 3)
+	d->kind = D_BIMODAL;
+    else if (sscanf(spec, "exp:%lf", &d->a) == 1)
+	d->kind = D_EXP;
+    else if (sscanf(spec, "fixed:%lf", &d->a) == 1)
+	d->kind = D_FIXED;
+    else if (strncmp(spec, "set:", 4) == 0) {
+	d->kind = D_SET;
+	for (p = spec + 4; *p; p += (*p == ',')) {
+	    if (d->n == MAX_SET ||
+		(d->set[d->n++] = strtol(p, &end, 10)) < 1 ||
+		(*end != ',' && *end != '\0'))
+		return -1;
+	    p = end;
+	}
+	return (d->n > 0) ? 0 : -1;
+    }
+    else
+	return -1;
+
+    if (d->kind == D_POW && (d->a < 1 || d->b < d->a || d->c <= 0))
+	return -1;
+    if (d->kind == D_UNIFORM && d->b < d->a)
+	return -1;
+    return 0;
+}
+
+/*
+ * heap_push, heap_pop, sift_down - the live blocks, as a binary
+ *     min-heap on death
+ */
+static void heap_push(block_t *heap, int *n, block_t b)
+{
+    int i = (*n)++;
+
+    while (i > 0 && heap[(i - 1) / 2].death > b.death) {
+	heap[i] = heap[(i - 1) / 2];
+	i = (i - 1) / 2;
+    }
+    heap[i] = b;
+}
+
+static block_t heap_pop(block_t *heap, int *n)
+{
+    block_t top = heap[0];
+
+    heap[0] = heap[--(*n)];
+    sift_down(heap, *n, 0);
+    return top;
+}
+
+static void sift_down(block_t *heap, int n, int i)
+{
+    block_t b = heap[i];
+    int child;
+
+    while ((child = 2 * i + 1) < n) {
+	if (child + 1 < n && heap[child + 1].death < heap[child].death)
+	    child++;
+	if (heap[child].death >= b.death)
+	    break;
+	heap[i] = heap[child];
+	i = child;
+    }
+    heap[i] = b;
+}
+
+/*
+ * emit - append a request to the trace, growing its array as needed
+ */
+static traceop_t *emit(trace_t *trace, int *cap)
+{
+    if (trace->num_ops == *cap) {
+	*cap = *cap ? 2 * *cap : 4096;
+	if ((trace->ops = (traceop_t *)
+	     realloc(trace->ops, *cap * sizeof(traceop_t))) == NULL) {
+	    perror("tracegen");
+	    exit(1);
+	}
+    }
+    return &trace->ops[trace->num_ops++];
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: tracegen [-hbv] [-d <dist>]... [-l <dist>]... [-n <reqs>]\n");
+    fprintf(stderr, "                [-p <reqs>] [-r <prob>] [-g <factor>] [-H <bytes>]\n");
+    fprintf(stderr, "                [-s <seed>] <outfile>\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-b          Write a binary trace instead of a .rep.\n");
+    fprintf(stderr, "\t-d <dist>   Block size distribution (default pow:8:4096:1.5).\n");
+    fprintf(stderr, "\t-g <factor> Realloc size factor (default 1.5).\n");
+    fprintf(stderr, "\t-h          Print this message.\n");
+    fprintf(stderr, "\t-H <bytes>  Free blocks early to keep the live payload near this.\n");
+    fprintf(stderr, "\t-l <dist>   Lifetime distribution, in requests (default exp:1000).\n");
+    fprintf(stderr, "\t-n <reqs>   Requests before the final frees (default 100000).\n");
+    fprintf(stderr, "\t-p <reqs>   Move to the next -d and -l every <reqs> requests.\n");
+    fprintf(stderr, "\t-r <prob>   Chance that a request reallocs a live block.\n");
+    fprintf(stderr, "\t-s <seed>   Random seed (default 1).\n");
+    fprintf(stderr, "\t-v          Print what was written.\n");
+    fprintf(stderr, "Distributions: uniform:lo:hi pow:lo:hi:alpha bimodal:x:y:p\n");
+    fprintf(stderr, "               set:x,y,... exp:mean fixed:n\n");
+}
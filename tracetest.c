@@ -0,0 +1,129 @@
+/*
+ * tracetest.c - regression tests for trace.c
+ *
+ *	make test
+ *
+ * Built with mdriver's CFLAGS, so under -m32 it checks that trace.c
+ * handles files larger than a 32-bit off_t can describe. The trace is
+ * written as a sparse file: it takes almost no disk space, and its holes
+ * read back as zeros, which are valid records. Prints one line per test
+ * and exits nonzero if any of them fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "trace.h"
+
+#define BIG_PATH "tracetest.bin"
+#define BIG_OPS  600000000LL  /* 4.8GB of records */
+
+int verbose = 0; /* read by trace.c */
+
+static int failures = 0;
+
+/* function prototypes */
+static int test_stream_big(void);
+static int put_record(int fd, long long i, int k);
+static void report(char *name, int ok);
+
+int main(void)
+{
+    report("streaming a binary trace larger than 4GB", test_stream_big());
+    unlink(BIG_PATH);
+    return failures ? 1 : 0;
+}
+
+/*
+ * test_stream_big - stream a trace of BIG_OPS records and check that
+ *     every one arrives in order: all of them zero (an alloc of id 0)
+ *     but the marked ones, placed at the start, just past 2GB and 4GB,
+ *     and at the end
+ */
+static int test_stream_big(void)
+{
+    long long marks[4];
+    long long i = 0;
+    int fd, n, j, m = 0;
+    tracehdr_t hdr;
+    trace_t header;
+    trace_stream_t *s;
+    traceop_t *ops;
+
+    marks[0] = 0;
+    marks[1] = ((1LL << 31) - (long long)sizeof(hdr)) / sizeof(traceop_t) + 1;
+    marks[2] = ((1LL << 32) - (long long)sizeof(hdr)) / sizeof(traceop_t) + 1;
+    marks[3] = BIG_OPS - 1;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.version = TRACE_VERSION;
+    hdr.num_ids = sizeof(marks) / sizeof(marks[0]) + 1;
+    hdr.num_ops = BIG_OPS;
+    hdr.weight = 1;
+    if ((fd = open(BIG_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0 ||
+	pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+	ftruncate(fd, sizeof(hdr) + BIG_OPS * sizeof(traceop_t)) < 0) {
+	perror("(" BIG_PATH ")");
+	return 0;
+    }
+    for (j = 0; j < 4; j++)
+	if (!put_record(fd, marks[j], j + 1))
+	    return 0;
+    close(fd);
+
+    s = open_trace_stream("", BIG_PATH, &header);
+    if (header.num_ops != BIG_OPS) {
+	printf("(header says %d ops) ", header.num_ops);
+	return 0;
+    }
+    while ((n = next_trace_window(s, &ops)) > 0)
+	for (j = 0; j < n; j++, i++) {
+	    if (m < 4 && i == marks[m]) {
+		if (ops[j].type != FREE || ops[j].index != m + 1 ||
+		    ops[j].size != m + 1) {
+		    printf("(op %lld is not mark %d) ", i, m + 1);
+		    return 0;
+		}
+		m++;
+	    }
+	    else if (ops[j].type != ALLOC || ops[j].index != 0 ||
+		     ops[j].size != 0) {
+		printf("(op %lld is not zero) ", i);
+		return 0;
+	    }
+	}
+    close_trace_stream(s);
+    if (i != BIG_OPS) {
+	printf("(streamed %lld of %lld ops) ", i, BIG_OPS);
+	return 0;
+    }
+    return 1;
+}
+
+/*
+ * put_record - write mark k as record i: a free of id k, with size k
+ */
+static int put_record(int fd, long long i, int k)
+{
+    traceop_t op;
+
+    op.type = FREE;
+    op.index = k;
+    op.size = k;
+    if (pwrite(fd, &op, sizeof(op), sizeof(tracehdr_t) +
+	       i * sizeof(traceop_t)) != sizeof(op)) {
+	perror("(" BIG_PATH ")");
+	return 0;
+    }
+    return 1;
+}
+
+static void report(char *name, int ok)
+{
+    printf("%s: %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok)
+	failures++;
+}